@@ -18,6 +18,56 @@
 #include <math.h>
 #include <errno.h>
 #include <string.h>
+#include <stdint.h>
+#include <float.h>
+#include <locale.h>
+
+#if defined(__AVX__)
+    #include <immintrin.h>
+#elif defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+    #define STAZ_HAVE_MMAP 1
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <sched.h>
+    #include <time.h>
+#else
+    #define STAZ_HAVE_MMAP 0
+#endif
+
+/* Access-pattern hints are skipped where madvise is not declared (e.g. strict ISO C modes) */
+#if defined(MADV_SEQUENTIAL)
+    #define STAZ_MADVISE(addr, len, advice) madvise((void *)(addr), (len), MADV_##advice)
+#else
+    #define STAZ_MADVISE(addr, len, advice) ((void)(addr), (void)(len))
+#endif
+
+/* Strict ISO modes hide pread; seek-and-read is used instead (it moves the file offset) */
+#if !defined(__STRICT_ANSI__) || defined(_XOPEN_SOURCE) || (defined(_POSIX_C_SOURCE) && _POSIX_C_SOURCE >= 200809L)
+    #define STAZ_PREAD(fd, buf, len, off) pread((fd), (buf), (len), (off))
+#else
+    #define STAZ_PREAD(fd, buf, len, off) \
+        (lseek((fd), (off), SEEK_SET) < 0 ? (ssize_t)-1 : read((fd), (buf), (len)))
+#endif
+
+/* nanosleep is hidden by the same modes; waits then fall back to yielding */
+#if STAZ_HAVE_MMAP && (!defined(__STRICT_ANSI__) || defined(_XOPEN_SOURCE) || (defined(_POSIX_C_SOURCE) && _POSIX_C_SOURCE >= 199309L))
+    #define STAZ_HAVE_NANOSLEEP 1
+#else
+    #define STAZ_HAVE_NANOSLEEP 0
+#endif
+
+#ifdef _OPENMP
+    #include <omp.h>
+    #define STAZ_OMP(...) _Pragma(#__VA_ARGS__)
+#else
+    #define STAZ_OMP(...)
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -45,12 +95,13 @@ typedef enum {
     MATH_DOMAIN_ERROR,
     NAN_ERROR,
     RANGEOUT_ERROR,
+    IO_ERROR,
     UNKNOWN_ERROR
 } staz_error;
 
 staz_error
 staz_geterrno() {
-    if (errno >= 0 && errno <= 6) {
+    if (errno >= 0 && errno < UNKNOWN_ERROR) {
         return (staz_error)errno;
     }
     return UNKNOWN_ERROR;
@@ -82,6 +133,9 @@ staz_strerrno() {
     case RANGEOUT_ERROR:
         msg = "Number as argument to function out of range";
         break;
+    case IO_ERROR:
+        msg = "File cannot be opened, read or mapped";
+        break;
     default:
         msg = "An unknown error occurred";
     }
@@ -130,6 +184,11 @@ copy_array(const double* nums, size_t len) {
     return copy;
 }
 
+/** Ranges up to this size end the pairwise recursion with an unrolled loop */
+#ifndef STAZ_SUM_BLOCK
+#define STAZ_SUM_BLOCK 32
+#endif
+
 /**
  * @brief Recursively computes the pairwise sum of elements in a double array
  * 
@@ -141,6 +200,8 @@ copy_array(const double* nums, size_t len) {
  * 
  * @note This function uses pairwise recursive summation to improve
  *       numerical accuracy compared to naive linear summation.
+ *       Blocks of up to STAZ_SUM_BLOCK values are summed with four
+ *       independent accumulators, so small arrays never recurse.
  *       It does not perform parameter validation; the caller must ensure:
  *       - nums is not NULL
  *       - start <= end
@@ -148,10 +209,21 @@ copy_array(const double* nums, size_t len) {
  */
 static double
 _staz_sum_recursive(const double* nums, size_t start, size_t end) {
-    if (start == end) {
-        return nums[start];
-    } else if (end - start == 1) {
-        return nums[start] + nums[end];
+    if (end - start < STAZ_SUM_BLOCK) {
+        double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+        size_t i = start;
+
+        for (; i + 3 <= end; i += 4) {
+            s0 += nums[i];
+            s1 += nums[i + 1];
+            s2 += nums[i + 2];
+            s3 += nums[i + 3];
+        }
+        for (; i <= end; i++) {
+            s0 += nums[i];
+        }
+
+        return (s0 + s1) + (s2 + s3);
     }
         
     size_t mid = start + (end - start) / 2;
@@ -205,840 +277,8507 @@ _sum_recp(const double* nums, size_t len) {
     return sum;
 }
 
+/* --- SORT ENGINE --- */
+
+/** Partitions up to this size are finished with an insertion sort */
+#ifndef STAZ_SORT_INSERTION_THRESHOLD
+#define STAZ_SORT_INSERTION_THRESHOLD 24
+#endif
+
+/** Partitions above this size pick the pivot with Tukey's ninther */
+#ifndef STAZ_SORT_NINTHER_THRESHOLD
+#define STAZ_SORT_NINTHER_THRESHOLD 128
+#endif
+
+/** Partitions up to this size are sorted with a fixed sorting network */
+#define STAZ_SORT_NETWORK_MAX 8
+
+#if !defined(__AVX512F__)
 /**
- * @brief Comparison function for qsort to sort doubles in ascending order
- * 
- * @param a Pointer to first double to compare
- * @param b Pointer to second double to compare
- * 
- * @return int Negative if a < b, zero if a == b, positive if a > b
+ * Comparator pairs of the optimal sorting networks for 2..8 elements,
+ * stored back to back; _staz_network_offset[n] is the first pair of the
+ * network for n elements and _staz_network_offset[n + 1] is one past its last.
+ */
+static const unsigned char _staz_network_pairs[] = {
+    /* 2 */ 0,1,
+    /* 3 */ 0,2, 0,1, 1,2,
+    /* 4 */ 0,2, 1,3, 0,1, 2,3, 1,2,
+    /* 5 */ 0,3, 1,4, 0,2, 1,3, 0,1, 2,4, 1,2, 3,4, 2,3,
+    /* 6 */ 0,5, 1,3, 2,4, 1,2, 3,4, 0,3, 2,5, 0,1, 2,3, 4,5, 1,2, 3,4,
+    /* 7 */ 0,6, 2,3, 4,5, 0,2, 1,4, 3,6, 0,1, 2,5, 3,4, 1,2, 4,6, 2,3, 4,5,
+            1,2, 3,4, 5,6,
+    /* 8 */ 0,2, 1,3, 4,6, 5,7, 0,4, 1,5, 2,6, 3,7, 0,1, 2,3, 4,5, 6,7, 2,4,
+            3,5, 1,4, 3,6, 1,2, 3,4, 5,6
+};
+
+static const unsigned char _staz_network_offset[STAZ_SORT_NETWORK_MAX + 2] = {
+    0, 0, 0, 1, 4, 9, 18, 30, 46, 65
+};
+#endif
+
+/**
+ * @brief Branchless compare-exchange: orders *a and *b ascending
  * 
- * @note Designed for use with qsort() standard library function
- * @warning Does not handle potential double overflow from subtraction
+ * @note Compiles to a min/max pair; operands must not be NAN
  */
-static inline int
-comp(const void *a, const void *b) {
-    double da = *(const double *)a, db = *(const double *)b;
-    return (da < db) ? -1 : (da > db) ? 1 : 0;
+static inline void
+_staz_cswap(double* a, double* b) {
+    const double x = *a, y = *b;
+    *a = (y < x) ? y : x;
+    *b = (y < x) ? x : y;
 }
 
-/* --- SHARED METHODS --- */
+static inline void
+_staz_swap(double* a, double* b) {
+    const double t = *a;
+    *a = *b;
+    *b = t;
+}
 
 /**
- * @brief Calculates the Pairwise summation of all elements in an array
+ * @brief Sorts three values in place so that *a <= *b <= *c
+ */
+static inline void
+_staz_sort3(double* a, double* b, double* c) {
+    _staz_cswap(a, b);
+    _staz_cswap(b, c);
+    _staz_cswap(a, b);
+}
+
+#if !defined(__AVX512F__)
+/**
+ * @brief Sorts up to STAZ_SORT_NETWORK_MAX values with a sorting network
  * 
- * @param nums Pointer to the array of double values
- * @param len Length of the array
+ * @param nums Pointer to the array of double values (no NAN allowed)
+ * @param len Length of the array, at most STAZ_SORT_NETWORK_MAX
+ */
+static void
+_staz_sort_network(double* nums, size_t len) {
+    const unsigned char* p = _staz_network_pairs + 2 * _staz_network_offset[len];
+    const unsigned char* end = _staz_network_pairs + 2 * _staz_network_offset[len + 1];
+
+    for (; p != end; p += 2) {
+        _staz_cswap(&nums[p[0]], &nums[p[1]]);
+    }
+}
+#else
+/**
+ * @brief Applies one layer of a sorting network to the 8 lanes of v
  * 
- * @return double The sum of all elements in the array
- *         NAN if nums is NULL or len is 0
+ * @param idx Partner lane of every lane (itself if the lane is idle)
+ * @param hi Mask of the lanes that receive the maximum of their pair
  * 
- * @note Sets errno to:
- *       - INVALID_PARAMETERS_ERROR if nums is NULL or len is 0
- *       - 0 if operation succeeds
+ * @note The masked forms of the intrinsics take v as their pass-through
+ *       source; the unmasked ones start from an undefined register, which
+ *       GCC 12 reports as used uninitialized in C++.
  */
-double
-staz_sum(const double* nums, size_t len) {
-    if (!nums || len == 0) {
-        errno = INVALID_PARAMETERS_ERROR;
-        return NAN;
-    }
+static inline __m512d
+_staz_avx512_layer(__m512d v, __m512i idx, __mmask8 hi) {
+    const __m512d p = _mm512_mask_permutexvar_pd(v, 0xFF, idx, v);
+    const __m512d lo = _mm512_mask_min_pd(v, (__mmask8)~hi, v, p);
+    return _mm512_mask_max_pd(lo, hi, v, p);
+}
 
-    errno = 0;
+/**
+ * @brief Sorts up to 8 values inside a single AVX-512 register
+ * 
+ * Unused lanes are padded with +INFINITY so the 8-wide network (the
+ * same comparators as the portable _staz_network_pairs) serves every length.
+ */
+static void
+_staz_sort8_avx512(double* nums, size_t len) {
+    const __mmask8 lanes = (__mmask8)((1u << len) - 1);
+    __m512d v = _mm512_mask_loadu_pd(_mm512_set1_pd(INFINITY), lanes, nums);
+
+    v = _staz_avx512_layer(v, _mm512_set_epi64(5, 4, 7, 6, 1, 0, 3, 2), 0xCC);
+    v = _staz_avx512_layer(v, _mm512_set_epi64(3, 2, 1, 0, 7, 6, 5, 4), 0xF0);
+    v = _staz_avx512_layer(v, _mm512_set_epi64(6, 7, 4, 5, 2, 3, 0, 1), 0xAA);
+    v = _staz_avx512_layer(v, _mm512_set_epi64(7, 6, 3, 2, 5, 4, 1, 0), 0x30);
+    v = _staz_avx512_layer(v, _mm512_set_epi64(7, 3, 5, 1, 6, 2, 4, 0), 0x50);
+    v = _staz_avx512_layer(v, _mm512_set_epi64(7, 5, 6, 3, 4, 1, 2, 0), 0x54);
+
+    _mm512_mask_storeu_pd(nums, lanes, v);
+}
+#endif
 
-    return _staz_sum_recursive(nums, 0, len - 1);
+/**
+ * @brief Sorts a partition of at most STAZ_SORT_NETWORK_MAX values
+ */
+static inline void
+_staz_sort_small(double* nums, size_t len) {
+#if defined(__AVX512F__)
+    if (len > 1) _staz_sort8_avx512(nums, len);
+#else
+    _staz_sort_network(nums, len);
+#endif
 }
 
+/** Arrays up to this size are copied on the stack and sorted with networks */
+#ifndef STAZ_SMALL_MAX
+#define STAZ_SMALL_MAX 32
+#endif
+
 /**
- * @brief Calculates the sum of squares of all elements in an array
+ * @brief Sorts a small array with Batcher's odd-even merge sorting network
  * 
- * @param nums Pointer to the array of double values
+ * @param nums Pointer to the array of double values (no NAN allowed)
  * @param len Length of the array
  * 
- * @return double The sum of squares of all elements
- *         NAN if nums is NULL or len is 0
- * 
- * @note Sets errno to:
- *       - INVALID_PARAMETERS_ERROR if nums is NULL or len is 0
- *       - 0 if operation succeeds
+ * @note The comparator schedule only depends on len, so the only
+ *       data-dependent operations are the branchless compare-exchanges.
  */
-double
-staz_quadratic_sum(const double* nums, size_t len) {
-    if (!nums || len == 0) {
-        errno = INVALID_PARAMETERS_ERROR;
-        return NAN;
+static void
+_staz_batcher_sort(double* nums, size_t len) {
+    for (size_t p = 1; p < len; p <<= 1) {
+        for (size_t k = p; k >= 1; k >>= 1) {
+            for (size_t j = k % p; j + k < len; j += 2 * k) {
+                for (size_t i = 0; i < k && i + j + k < len; i++) {
+                    if ((i + j) / (2 * p) == (i + j + k) / (2 * p)) {
+                        _staz_cswap(&nums[i + j], &nums[i + j + k]);
+                    }
+                }
+            }
+        }
     }
+}
 
-    errno = 0;
+/**
+ * @brief Sorts an array with a straight insertion sort
+ */
+static void
+_staz_insertion_sort(double* nums, size_t len) {
+    for (size_t i = 1; i < len; i++) {
+        const double x = nums[i];
+        size_t j = i;
 
-    double vsum = 0;
+        while (j > 0 && x < nums[j - 1]) {
+            nums[j] = nums[j - 1];
+            j--;
+        }
 
-    // Sum squares of all values in array
-    for (size_t i = 0; i < len; i++) {
-        vsum += nums[i] * nums[i];
+        nums[j] = x;
     }
-
-    return vsum;
 }
 
 /**
- * @brief Calculates the product of all elements in an array
- * 
- * @param nums Pointer to the array of double values
- * @param len Length of the array
- * 
- * @return double The product of all elements
- *         NAN if nums is NULL or len is 0
+ * @brief Insertion sort that gives up after a few element moves
  * 
- * @note Sets errno to:
- *       - INVALID_PARAMETERS_ERROR if nums is NULL or len is 0
- *       - 0 if operation succeeds
- *       - Stops calculation early if product becomes 0
+ * @return int 1 if the array is now sorted, 0 if the attempt was aborted
  */
-double
-staz_prod(const double* nums, size_t len) {
-    if (!nums || len == 0) {
-        errno = INVALID_PARAMETERS_ERROR;
-        return NAN;
+static int
+_staz_partial_insertion_sort(double* nums, size_t len) {
+    size_t moves = 0;
+
+    for (size_t i = 1; i < len; i++) {
+        const double x = nums[i];
+        size_t j = i;
+
+        while (j > 0 && x < nums[j - 1]) {
+            nums[j] = nums[j - 1];
+            j--;
+        }
+
+        nums[j] = x;
+        moves += i - j;
+
+        if (moves > 8) return 0;
     }
 
-    errno = 0;
+    return 1;
+}
 
-    double product = 1.0;
+static void
+_staz_sift_down(double* nums, size_t len, size_t root) {
+    const double x = nums[root];
 
-    // Multiply all values of array
-    for (size_t i = 0; i < len; i++) {
-        product *= nums[i];
-        if (product == 0.0) break;  // Early termination optimization
+    for (size_t child; (child = 2 * root + 1) < len; root = child) {
+        if (child + 1 < len && nums[child] < nums[child + 1]) child++;
+        if (!(x < nums[child])) break;
+        nums[root] = nums[child];
     }
 
-    return product;
+    nums[root] = x;
 }
 
 /**
- * @brief Finds the minimum value in an array
- * 
- * @param nums Pointer to the array of double values
- * @param len Length of the array
+ * @brief Heapsort, the O(n log n) fallback for adversarial partitions
+ */
+static void
+_staz_heap_sort(double* nums, size_t len) {
+    for (size_t i = len / 2; i-- > 0;) {
+        _staz_sift_down(nums, len, i);
+    }
+
+    for (size_t i = len - 1; i > 0; i--) {
+        _staz_swap(&nums[0], &nums[i]);
+        _staz_sift_down(nums, i, 0);
+    }
+}
+
+/**
+ * @brief Branchless Lomuto partition around the pivot stored in nums[0]
  * 
- * @return double The minimum value in the array
- *         NAN if nums is NULL or len is 0
+ * @param nums Pointer to the partition, pivot first
+ * @param len Length of the partition
+ * @param partitioned Set to 1 if the input was already partitioned
  * 
- * @note Sets errno to:
- *       - INVALID_PARAMETERS_ERROR if nums is NULL or len is 0
- *       - 0 if operation succeeds
+ * @return size_t Final index of the pivot; smaller elements are on its left
  */
-double
-staz_min_value(const double* nums, size_t len) {
-    if (!nums || len == 0) {
-        errno = INVALID_PARAMETERS_ERROR;
-        return NAN;
+static size_t
+_staz_partition_right(double* nums, size_t len, int* partitioned) {
+    const double pivot = nums[0];
+    double* rest = nums + 1;
+    size_t lt = 0, moved = 0;
+
+    for (size_t i = 0; i < len - 1; i++) {
+        const double x = rest[i];
+        const size_t smaller = x < pivot;
+
+        moved |= smaller & (lt != i);
+        rest[i] = rest[lt];
+        rest[lt] = x;
+        lt += smaller;
     }
 
-    errno = 0;
+    nums[0] = nums[lt];
+    nums[lt] = pivot;
 
-    double min = nums[0];
+    *partitioned = !moved;
+    return lt;
+}
 
-    for (size_t i = 1; i < len; i++) {
-        if (nums[i] < min) min = nums[i];
+/**
+ * @brief Branchless partition that puts elements equal to the pivot on its left
+ * 
+ * @return size_t Final index of the pivot; elements <= pivot are on its left
+ */
+static size_t
+_staz_partition_left(double* nums, size_t len) {
+    const double pivot = nums[0];
+    double* rest = nums + 1;
+    size_t le = 0;
+
+    for (size_t i = 0; i < len - 1; i++) {
+        const double x = rest[i];
+        const size_t not_greater = !(pivot < x);
+
+        rest[i] = rest[le];
+        rest[le] = x;
+        le += not_greater;
     }
 
-    return min;
+    nums[0] = nums[le];
+    nums[le] = pivot;
+
+    return le;
 }
 
 /**
- * @brief Finds the maximum value in an array
+ * @brief Pattern-defeating quicksort main loop
  * 
- * @param nums Pointer to the array of double values
- * @param len Length of the array
- * 
- * @return double The maximum value in the array
- *         NAN if nums is NULL or len is 0
+ * @param nums Pointer to the partition (no NAN allowed)
+ * @param len Length of the partition
+ * @param bad_allowed Unbalanced partitions tolerated before falling back to heapsort
+ * @param leftmost Non-zero if nums[-1] is not part of the array
  * 
- * @note Sets errno to:
- *       - INVALID_PARAMETERS_ERROR if nums is NULL or len is 0
- *       - 0 if operation succeeds
+ * @note Recurses on the smaller side only, so stack depth is O(log n)
  */
-double
-staz_max_value(const double* nums, size_t len) {
-    if (!nums || len == 0) {
-        errno = INVALID_PARAMETERS_ERROR;
-        return NAN;
-    }
+static void
+_staz_pdqsort(double* nums, size_t len, int bad_allowed, int leftmost) {
+    while (len > STAZ_SORT_INSERTION_THRESHOLD) {
+        const size_t half = len / 2;
+
+        // Move the pivot candidate to nums[0]
+        if (len > STAZ_SORT_NINTHER_THRESHOLD) {
+            _staz_sort3(nums, nums + half, nums + len - 1);
+            _staz_sort3(nums + 1, nums + half - 1, nums + len - 2);
+            _staz_sort3(nums + 2, nums + half + 1, nums + len - 3);
+            _staz_sort3(nums + half - 1, nums + half, nums + half + 1);
+            _staz_swap(nums, nums + half);
+        } else {
+            _staz_sort3(nums + half, nums, nums + len - 1);
+        }
 
-    errno = 0;
+        // A pivot equal to the predecessor means the run of equal values is already placed
+        if (!leftmost && !(nums[-1] < nums[0])) {
+            const size_t pivot_pos = _staz_partition_left(nums, len);
+            nums += pivot_pos + 1;
+            len -= pivot_pos + 1;
+            continue;
+        }
 
-    double max = nums[0];
+        int partitioned;
+        const size_t pivot_pos = _staz_partition_right(nums, len, &partitioned);
+        const size_t l_size = pivot_pos;
+        const size_t r_size = len - pivot_pos - 1;
+
+        if (l_size < len / 8 || r_size < len / 8) {
+            if (--bad_allowed == 0) {
+                _staz_heap_sort(nums, len);
+                return;
+            }
+
+            // Break up patterns that produced the unbalanced partition
+            if (l_size >= STAZ_SORT_INSERTION_THRESHOLD) {
+                _staz_swap(nums, nums + l_size / 4);
+                _staz_swap(nums + pivot_pos - 1, nums + pivot_pos - l_size / 4);
+            }
+            if (r_size >= STAZ_SORT_INSERTION_THRESHOLD) {
+                _staz_swap(nums + pivot_pos + 1, nums + pivot_pos + 1 + r_size / 4);
+                _staz_swap(nums + len - 1, nums + len - r_size / 4);
+            }
+        } else if (partitioned
+                   && _staz_partial_insertion_sort(nums, l_size)
+                   && _staz_partial_insertion_sort(nums + pivot_pos + 1, r_size)) {
+            return;
+        }
 
-    for (size_t i = 1; i < len; i++) {
-        if (nums[i] > max) max = nums[i];
+        if (l_size < r_size) {
+            _staz_pdqsort(nums, l_size, bad_allowed, leftmost);
+            nums += pivot_pos + 1;
+            len = r_size;
+            leftmost = 0;
+        } else {
+            _staz_pdqsort(nums + pivot_pos + 1, r_size, bad_allowed, 0);
+            len = l_size;
+        }
     }
 
-    return max;
+    if (len <= STAZ_SORT_NETWORK_MAX) {
+        _staz_sort_small(nums, len);
+    } else {
+        _staz_insertion_sort(nums, len);
+    }
 }
 
-/* --- PUBLIC METHODS --- */
+/** Arrays of at least this many values are sorted with the LSD radix sort */
+#ifndef STAZ_RADIX_SORT_THRESHOLD
+#define STAZ_RADIX_SORT_THRESHOLD (1u << 20)
+#endif
 
-/**
- * @brief Enumeration of different mean types supported by the library
- */
-typedef enum {
-    ARITHMETICAL, /** Arithmetic mean (average) */
-    GEOMETRICAL,  /** Geometric mean (nth root of product) */
-    HARMONICAL,   /** Harmonic mean (reciprocal of average of reciprocals) */
-    QUADRATICAL,  /** Quadratic mean (root mean square) */
-    EXTREMES,     /** Mean of extreme values (min and max) */
-    TRIMEAN,      /** The Tukey's mean */
-    MIDHINGE      /** Mean of Q1 and Q2 */
-} staz_mean_type;
+#define STAZ_RADIX_BITS 11
+#define STAZ_RADIX_BUCKETS (1u << STAZ_RADIX_BITS)
+#define STAZ_RADIX_PASSES ((64 + STAZ_RADIX_BITS - 1) / STAZ_RADIX_BITS)
 
-/**
- * @brief Enumeration of different range types supported by the library
- */
-typedef enum {
-    R_STANDARD,      /** Standard range */
-    R_INTERQUARTILE, /** Interquartile range (IQR) */
-    R_PERCENTILE,    /** Percentile range */
-} staz_range_type;
+/** Distance, in elements, of the scatter destination prefetch */
+#define STAZ_RADIX_PREFETCH 16
 
-/**
- * @brief Enum for different deviation calculation methods
- */
-typedef enum {
-    D_STANDARD, /** Standard deviation from mean */
-    D_AVERAGE,  /** Average deviation method */
-    D_RELATIVE, /** Relative deviation calculation */
-    D_MAD_AVG,  /** Mean Absolute Deviation from average */
-    D_MAD_MED,  /** Mean Absolute Deviation from median */
-} staz_deviation_type;
+#if defined(__GNUC__) || defined(__clang__)
+    #define STAZ_PREFETCH(addr) __builtin_prefetch((addr), 1)
+#else
+    #define STAZ_PREFETCH(addr) ((void)(addr))
+#endif
 
 /**
- * @brief Structure representing the information required to draw a boxplot.
+ * @brief Maps a double to an unsigned key with the same ordering
+ * 
+ * Positive values get the sign bit flipped, negative values get every
+ * bit flipped, so unsigned comparison of keys matches IEEE-754 order.
  */
-typedef struct {
-    double BOX_HIGH;          /** Q3 */
-    double BOX_CENTRE;        /** Median */
-    double BOX_LOW;           /** Q1 */
-    double BOX_UPPER_WHISKER; /** Q3 + 1.5 * iqr */
-    double BOX_LOWER_WHISKER; /** Q1 - 1.5 * iqr */
-    double BOX_UPPER_OUTLIER; /** max */
-    double BOX_LOWER_OUTLIER; /** min */
-} staz_boxplot_info;
+static inline uint64_t
+_staz_double_to_key(double x) {
+    uint64_t u;
+    memcpy(&u, &x, sizeof(u));
+    return u ^ ((0 - (u >> 63)) | 0x8000000000000000ULL);
+}
 
 /**
- * @brief Structure representing a linear equation in the form y = mx + q
+ * @brief Inverse of _staz_double_to_key
  */
-typedef struct {
-    double m; /** Slope of the line (coefficient of x) */
-    double q; /** Y-intercept (constant term) */
-} staz_line_equation;
+static inline double
+_staz_key_to_double(uint64_t u) {
+    u ^= ((u >> 63) - 1) | 0x8000000000000000ULL;
+
+    double x;
+    memcpy(&x, &u, sizeof(x));
+    return x;
+}
 
 /**
- * @brief Calculates the median value
+ * @brief LSD radix sort of unsigned 64-bit keys with 11-bit digits
  * 
- * @param nums Pointer to the array of double values
- * @param len Length of the array
+ * @param keys Keys to sort
+ * @param tmp Scratch area of len keys
+ * @param hist Scratch area of STAZ_RADIX_PASSES * STAZ_RADIX_BUCKETS counters
+ * @param len Number of keys
  * 
- * @return double The median value of the array
- *         - For odd-sized arrays: middle element
- *         - For even-sized arrays: average of the two middle elements
- *         - NAN if nums is NULL or len is 0
+ * @return uint64_t* Either keys or tmp, whichever holds the sorted output
  * 
- * @note Sets errno to:
- *       - INVALID_PARAMETERS_ERROR if nums is NULL or len is 0
- *       - 0 if operation succeeds
+ * @note All digit histograms are built in a single read pass; passes whose
+ *       digit is the same for every key are skipped.
  */
-double
-staz_median(double* nums, size_t len) {
-    if (!nums || len == 0) {
-        errno = INVALID_PARAMETERS_ERROR;
-        return NAN;
-    }
+static uint64_t*
+_staz_radix_sort_u64(uint64_t* keys, uint64_t* tmp, size_t* hist, size_t len) {
+    const uint64_t mask = STAZ_RADIX_BUCKETS - 1;
 
-    errno = 0;
+    memset(hist, 0, STAZ_RADIX_PASSES * STAZ_RADIX_BUCKETS * sizeof(size_t));
 
-    double* sorted = copy_array(nums, len);
-    if (!sorted) return NAN;
+    for (size_t i = 0; i < len; i++) {
+        const uint64_t k = keys[i];
 
-    qsort(sorted, len, sizeof(double), comp);
+        for (unsigned p = 0; p < STAZ_RADIX_PASSES; p++) {
+            hist[p * STAZ_RADIX_BUCKETS + ((k >> (p * STAZ_RADIX_BITS)) & mask)]++;
+        }
+    }
 
-    double med;
+    uint64_t* src = keys;
+    uint64_t* dst = tmp;
 
-    if (len == 1) {
-        med = sorted[0];
-    } else if (len % 2 != 0) {
-        med = sorted[len / 2];
-    } else {
-        const size_t middle = len / 2;
-        med = (sorted[middle - 1] + sorted[middle]) / 2.0;
-    }
+    for (unsigned p = 0; p < STAZ_RADIX_PASSES; p++) {
+        const unsigned shift = p * STAZ_RADIX_BITS;
+        size_t* off = hist + p * STAZ_RADIX_BUCKETS;
 
-    free(sorted);
-    return med;
-}
+        if (off[(src[0] >> shift) & mask] == len) continue;
+
+        // Turn counts into exclusive offsets
+        size_t total = 0;
+        for (size_t d = 0; d < STAZ_RADIX_BUCKETS; d++) {
+            const size_t c = off[d];
+            off[d] = total;
+            total += c;
+        }
+
+        size_t i = 0;
+
+        for (; i + STAZ_RADIX_PREFETCH < len; i++) {
+            STAZ_PREFETCH(&dst[off[(src[i + STAZ_RADIX_PREFETCH] >> shift) & mask]]);
+
+            const uint64_t k = src[i];
+            dst[off[(k >> shift) & mask]++] = k;
+        }
+        for (; i < len; i++) {
+            const uint64_t k = src[i];
+            dst[off[(k >> shift) & mask]++] = k;
+        }
+
+        uint64_t* t = src;
+        src = dst;
+        dst = t;
+    }
+
+    return src;
+}
 
 /**
- * @brief Calculates the quantile for a numeric array
+ * @brief Sorts an array of doubles with an LSD radix sort on their bit keys
  * 
- * @param mtype Quantile division (e.g., 1000, 20, 30, 4)
- * @param nums Pointer to array of double values
+ * @param nums Pointer to the array of double values (no NAN allowed)
  * @param len Length of the array
- * @param posx Position of the quantile (range: 1 to mtype-1)
- * 
- * @return double The calculated quantile value
- *         NAN if input is invalid
- *
- * @note Sets errno to:
- *       - INVALID_PARAMETERS_ERROR if nums is NULL or len or posx is invalid
- *       - RANGEOUT_ERROR if mtype is invalid for len of nums
- *       - 0 if operation succeeds
  * 
- * @note Calculates quantile using linear interpolation method
+ * @return int 1 on success, 0 if the scratch buffer could not be allocated
  */
-double
-staz_quantile(int mtype, size_t posx, double* nums, size_t len) {
-    if (!nums || len == 0 || posx < 1) {
-        errno = INVALID_PARAMETERS_ERROR;
-        return NAN;
-    }
-
-    /* Measure type must be between 1 and mtype-1 */
-    if (posx > (size_t)mtype - 1) {
-        errno = RANGEOUT_ERROR;
-        return NAN;
-    }
-
-    errno = 0;
-
-    double* sorted = copy_array(nums, len);
-    if (!sorted) return NAN;
+static int
+_staz_radix_sort(double* nums, size_t len) {
+    // Keys, ping-pong buffer and histograms share one allocation
+    uint64_t* keys = (uint64_t *)malloc(2 * len * sizeof(uint64_t)
+                                        + STAZ_RADIX_PASSES * STAZ_RADIX_BUCKETS * sizeof(size_t));
+    if (!keys) return 0;
 
-    qsort(sorted, len, sizeof(double), comp);
+    uint64_t* tmp = keys + len;
+    size_t* hist = (size_t *)(tmp + len);
 
-    const double index = posx * (len + 1) / (double)mtype;
+    for (size_t i = 0; i < len; i++) {
+        keys[i] = _staz_double_to_key(nums[i]);
+    }
 
-    size_t lower = (size_t)index;
+    const uint64_t* sorted = _staz_radix_sort_u64(keys, tmp, hist, len);
 
-    if (lower >= len) {
-        const int ret = sorted[len - 1];
-        free(sorted);
-        return ret;
-    }
-    if (lower <= 0) {
-        const int ret = sorted[0];
-        free(sorted);
-        return ret;
+    for (size_t i = 0; i < len; i++) {
+        nums[i] = _staz_key_to_double(sorted[i]);
     }
 
-    double qu = sorted[lower - 1] + (index - lower) * (sorted[lower] - sorted[lower - 1]);
-    free(sorted);
-    return qu;
+    free(keys);
+    return 1;
 }
 
 /**
- * @brief Calculates different types of means for an array of values
+ * @brief Moves every NAN to the end of an array
  * 
- * @param mtype The type of mean to calculate (from MeanType enum)
  * @param nums Pointer to the array of double values
  * @param len Length of the array
  * 
- * @return double The calculated mean value
- *         NAN if:
- *         - nums is NULL or len is 0
- *         - GEOMETRICAL mean with negative product
- *         - HARMONICAL mean with any element = 0
- *         - V_OF_EXTREME with len < 2
- *         - Invalid mtype provided
- * 
- * @note Sets errno to:
- *       - INVALID_PARAMETERS_ERROR if nums is NULL, len is 0, or invalid mtype
- *       - MATH_DOMAIN_ERROR for mathematical domain errors
- *       - 0 if operation succeeds
+ * @return size_t Number of values that are not NAN, now at the front
  */
-double
-staz_mean(staz_mean_type mtype, double* nums, size_t len) {
-    if (!nums || len == 0) {
-        errno = INVALID_PARAMETERS_ERROR;
-        return NAN;
-    }
+static size_t
+_staz_partition_nan(double* nums, size_t len) {
+    size_t n = 0;
 
-    errno = 0;
+    for (size_t i = 0; i < len; i++) {
+        const double x = nums[i];
+        const size_t keep = !isnan(x);
 
-    switch (mtype) {
-    case ARITHMETICAL:
-        return staz_sum(nums, len) / len;
+        nums[i] = nums[n];
+        nums[n] = x;
+        n += keep;
+    }
 
-    case GEOMETRICAL: {
-        const double prod_value = staz_prod(nums, len);
-        if (prod_value == 0) return 0.0;
-        if (prod_value < 0) {
-            errno = MATH_DOMAIN_ERROR;
-            return NAN;
-        }
+    return n;
+}
 
-        return staz_sqrti(len, prod_value);
+/**
+ * @brief Sorts an array of at most STAZ_SMALL_MAX doubles with networks only
+ * 
+ * @note NAN values are moved to the end of the array.
+ *       It does not perform parameter validation.
+ */
+static void
+_staz_sort_tiny(double* nums, size_t len) {
+    const size_t n = _staz_partition_nan(nums, len);
+
+    if (n <= STAZ_SORT_NETWORK_MAX) {
+        _staz_sort_small(nums, n);
+    } else {
+        _staz_batcher_sort(nums, n);
     }
-        
-    case HARMONICAL: {
-        const double recp_sum = _sum_recp(nums, len);
-        if (isnan(recp_sum)) return NAN;
+}
 
-        return len / recp_sum;
+/**
+ * @brief Sorts an array of doubles that holds no NAN
+ * 
+ * @note Uses a sorting network for tiny arrays, the LSD radix sort from
+ *       STAZ_RADIX_SORT_THRESHOLD values up and the branchless
+ *       pattern-defeating quicksort otherwise.
+ */
+static void
+_staz_sort_serial(double* nums, size_t len) {
+    if (len <= STAZ_SORT_NETWORK_MAX) {
+        _staz_sort_small(nums, len);
+        return;
     }
 
-    case QUADRATICAL:
-        return sqrt(staz_quadratic_sum(nums, len) / len);
+    if (len >= STAZ_RADIX_SORT_THRESHOLD && _staz_radix_sort(nums, len)) return;
 
-    case EXTREMES: {
-        if (len < 2) {
-            errno = INVALID_PARAMETERS_ERROR;
-            return NAN;
-        }
+    int bad_allowed = 0;
+    for (size_t k = len; k > 1; k >>= 1) bad_allowed++;
 
-        return (staz_min_value(nums, len) + staz_max_value(nums, len)) / 2.0;
-    }
+    _staz_pdqsort(nums, len, bad_allowed, 1);
+}
 
-    case TRIMEAN: {
-        const double q1 = staz_quantile(4, 1, nums, len);
-        const double q2 = staz_quantile(4, 2, nums, len);
-        const double q3 = staz_quantile(4, 3, nums, len);
+/** Arrays of at least this many values are sorted by all threads */
+#ifndef STAZ_PARALLEL_THRESHOLD
+#define STAZ_PARALLEL_THRESHOLD (1u << 17)
+#endif
 
-        return (q1 + 2 * q2 + q3) / 4.0;
-    }
+/** Buckets per thread and samples per bucket of the sample sort */
+#define STAZ_SAMPLE_BUCKETS_PER_THREAD 4
+#define STAZ_SAMPLE_OVERSAMPLING 32
 
-    case MIDHINGE: {
-        const double q1 = staz_quantile(4, 1, nums, len);
-        const double q3 = staz_quantile(4, 3, nums, len);
+/**
+ * @brief Returns the number of threads parallel kernels may use
+ */
+static inline size_t
+_staz_num_threads(void) {
+#ifdef _OPENMP
+    return (size_t)omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
 
-        return (q1 + q3) / 2;
+/**
+ * @brief Counts the splitters that are less than or equal to x
+ * 
+ * @param splitters Sorted array of splitters
+ * @param count Number of splitters
+ * @param x Value to classify
+ * 
+ * @return size_t Index of the bucket x belongs to
+ */
+static inline size_t
+_staz_bucket_of(const double* splitters, size_t count, double x) {
+    size_t lo = 0;
+
+    while (count > 0) {
+        const size_t half = count / 2;
+        const int right = !(x < splitters[lo + half]);
+
+        lo = right ? lo + half + 1 : lo;
+        count = right ? count - half - 1 : half;
     }
 
-    default:
-        errno = INVALID_PARAMETERS_ERROR;
-        return NAN;
+    return lo;
+}
+
+/**
+ * @brief Finds the bucket that holds a given rank
+ * 
+ * @param first Global rank of the first value of each bucket, plus the total
+ * @param count Number of buckets
+ * @param rank Zero-based rank, less than first[count]
+ * 
+ * @return size_t Index of the non-empty bucket holding the rank
+ */
+static inline size_t
+_staz_bucket_of_rank(const size_t* first, size_t count, size_t rank) {
+    size_t lo = 0;
+
+    while (count > 0) {
+        const size_t half = count / 2;
+
+        if (first[lo + half + 1] <= rank) {
+            lo += half + 1;
+            count -= half + 1;
+        } else {
+            count = half;
+        }
     }
+
+    return lo;
 }
 
 /**
- * @brief Calculates the variance of values in an array
+ * @brief Picks k - 1 splitters for a sample sort or a bucket selection
  * 
  * @param nums Pointer to the array of double values
- * @param len Length of the array
+ * @param len Length of the array, at least k * STAZ_SAMPLE_OVERSAMPLING
+ * @param k Number of buckets
+ * @param splitters Output array of k - 1 values
  * 
- * @return double The variance of the values
- *         NAN if nums is NULL or len is 0
+ * @return int 1 on success, 0 if memory allocation fails or fewer than
+ *         half of the sampled values are numbers
  * 
- * @note Sets errno to:
- *       - INVALID_PARAMETERS_ERROR if nums is NULL or len is 0
- *       - NAN_ERROR if computed value of mean is NAN
- *       - 0 if operation succeeds
- *       - This calculates population variance (dividing by n, not n-1)
+ * @note The sample is taken with a regular stride, NANs are dropped and
+ *       the rest is sorted and cut into k equal parts.
  */
-double
-staz_variance(double* nums, size_t len) {
-    if (!nums || len == 0) {
-        errno = INVALID_PARAMETERS_ERROR;
-        return NAN;
-    }
+static int
+_staz_pick_splitters(const double* nums, size_t len, size_t k, double* splitters) {
+    const size_t count = k * STAZ_SAMPLE_OVERSAMPLING;
+    double* sample = (double *)malloc(count * sizeof(double));
+    if (!sample) return 0;
 
-    errno = 0;
+    const size_t stride = len / count;
 
-    const double mean_value = staz_mean(ARITHMETICAL, nums, len);
+    for (size_t i = 0; i < count; i++) {
+        sample[i] = nums[i * stride + (i * 7919) % stride];
+    }
 
-    if (isnan(mean_value)) {
-        errno = NAN_ERROR;
-        return NAN;
+    const size_t valid = _staz_partition_nan(sample, count);
+    if (valid < count / 2) {
+        free(sample);
+        return 0;
     }
 
-    for (size_t i = 0; i < len; i++) {
-        const double diff = nums[i] - mean_value;
-        nums[i] = diff * diff;
+    _staz_sort_serial(sample, valid);
+
+    for (size_t j = 1; j < k; j++) {
+        splitters[j - 1] = sample[j * valid / k];
     }
 
-    return staz_mean(ARITHMETICAL, nums, len);
+    free(sample);
+    return 1;
 }
 
 /**
- * This function supports multiple deviation metrics:
- * - Standard deviation: square root of variance
- * - Relative deviation: standard deviation divided by mean (coefficient of variation)
- * - Mean absolute deviation: average of absolute deviations from the mean
- * - Median absolute deviation: median of absolute deviations from the median
+ * @brief Sorts an array of doubles with a parallel sample sort
  * 
- * @param dtype Type of deviation to calculate (from staz_deviation_type enum)
- * @param nums Pointer to the array of double values
+ * @param nums Pointer to the array of double values (no NAN allowed)
  * @param len Length of the array
  * 
- * @return double The calculated deviation value
- *         NAN if:
- *         - nums is NULL or len is 0
- *         - RELATIVE deviation when mean equals zero
- *         - Memory allocation fails for MAD_MED
- *         - Invalid dtype provided
+ * @return int 1 on success, 0 if only one thread is available or memory
+ *         allocation fails (nums is left untouched in that case)
  * 
- * @note Sets errno to:
- *       - INVALID_PARAMETERS_ERROR if nums is NULL, len is 0, or invalid dtype
- *       - NAN_ERROR or ZERO_DIVISION_ERROR if computed values is NAN or zero
- *       - MEMORY_ALLOCATION_ERROR if memory allocation fails for MAD_MED
- *       - 0 if operation succeeds
+ * @note Every thread counts its block of the input per bucket, then
+ *       scatters it into disjoint slices of one output buffer, and the
+ *       buckets are finally sorted independently. Threads come from
+ *       OpenMP, so without -fopenmp this always returns 0.
  */
-double
-staz_deviation(staz_deviation_type dtype, double* nums, size_t len) {
-    if (!nums || len == 0) {
-        errno = INVALID_PARAMETERS_ERROR;
-        return NAN;
+static int
+_staz_parallel_sort(double* nums, size_t len) {
+    const size_t threads = _staz_num_threads();
+    const size_t k = threads * STAZ_SAMPLE_BUCKETS_PER_THREAD;
+
+    if (threads < 2 || len < k * STAZ_SAMPLE_OVERSAMPLING) return 0;
+
+    double* out = (double *)malloc(len * sizeof(double));
+    double* splitters = (double *)malloc((k - 1) * sizeof(double));
+    size_t* counts = (size_t *)calloc(threads * k + k + 1, sizeof(size_t));
+
+    if (!out || !splitters || !counts || !_staz_pick_splitters(nums, len, k, splitters)) {
+        free(out);
+        free(splitters);
+        free(counts);
+        return 0;
     }
 
-    errno = 0;
+    size_t* bucket_start = counts + threads * k;
 
-    switch (dtype) {
-    case D_STANDARD: {
-        const double variance_value = staz_variance(nums, len);
+    STAZ_OMP(omp parallel num_threads(threads))
+    {
+#ifdef _OPENMP
+        const size_t t = (size_t)omp_get_thread_num();
+        const size_t nt = (size_t)omp_get_num_threads();
+#else
+        const size_t t = 0, nt = 1;
+#endif
+        const size_t begin = len * t / nt;
+        const size_t end = len * (t + 1) / nt;
+        size_t* mine = counts + t * k;
 
-        if (isnan(variance_value)) {
-            errno = NAN_ERROR;
-            return NAN;
+        for (size_t i = begin; i < end; i++) {
+            mine[_staz_bucket_of(splitters, k - 1, nums[i])]++;
         }
 
-        return sqrt(variance_value);
-    }
-    
-    case D_RELATIVE: {
-        const double meanv = staz_mean(ARITHMETICAL, nums, len);
-        if (isnan(meanv)) {
-            errno = NAN_ERROR;
-            return NAN;
-        } else if (meanv == 0) {
-            errno = ZERO_DIVISION_ERROR;
-            return NAN;
-        }
+        STAZ_OMP(omp barrier)
 
-        return staz_deviation(D_STANDARD, nums, len) / meanv;
-    }
-    
-    case D_MAD_AVG: {
-        const double meanv = staz_mean(ARITHMETICAL, nums, len);
+        // Bucket-major prefix sums give every thread its own output slices
+        STAZ_OMP(omp single)
+        {
+            size_t total = 0;
 
-        for (size_t i = 0; i < len; i++) {
-            nums[i] = fabs(nums[i] - meanv);
+            for (size_t b = 0; b < k; b++) {
+                bucket_start[b] = total;
+
+                for (size_t u = 0; u < nt; u++) {
+                    const size_t c = counts[u * k + b];
+                    counts[u * k + b] = total;
+                    total += c;
+                }
+            }
+
+            bucket_start[k] = total;
         }
-        
-        return staz_mean(ARITHMETICAL, nums, len);
-    }
 
-    case D_MAD_MED: {
-        const double medv = staz_median(nums, len);
+        for (size_t i = begin; i < end; i++) {
+            const double x = nums[i];
+            out[mine[_staz_bucket_of(splitters, k - 1, x)]++] = x;
+        }
 
-        for (size_t i = 0; i < len; i++) {
-            nums[i] = fabs(nums[i] - medv);
+        STAZ_OMP(omp barrier)
+
+        STAZ_OMP(omp for schedule(dynamic, 1))
+        for (size_t b = 0; b < k; b++) {
+            _staz_sort_serial(out + bucket_start[b], bucket_start[b + 1] - bucket_start[b]);
         }
 
-        return staz_mean(ARITHMETICAL, nums, len);
+        memcpy(nums + begin, out + begin, (end - begin) * sizeof(double));
     }
 
-    default:
-        errno = INVALID_PARAMETERS_ERROR;
-        return NAN;
-    }
+    free(out);
+    free(splitters);
+    free(counts);
+    return 1;
 }
 
 /**
- * @brief Calculates the mode (most frequent value) of values in an array
+ * @brief Sorts an array of doubles in ascending order
  * 
  * @param nums Pointer to the array of double values
  * @param len Length of the array
  * 
- * @note Sets errno to:
- *       - INVALID_PARAMETERS_ERROR if nums is NULL or len is 0
- *       - 0 if operation succeeds
+ * @note NAN values are moved to the end of the array and the rest is sorted
+ *       by all threads from STAZ_PARALLEL_THRESHOLD values up, or by
+ *       _staz_sort_serial otherwise.
+ *       It does not perform parameter validation.
  */
-double
-staz_mode(const double* nums, size_t len) {
-    if (!nums || len == 0) {
-        errno = INVALID_PARAMETERS_ERROR;
-        return NAN;
-    }
-
-    errno = 0;
+static void
+_staz_sort(double* nums, size_t len) {
+    const size_t n = _staz_partition_nan(nums, len);
 
-    double maxv = 0, maxc = 0;
-
-    for (size_t i = 0; i < len; ++i) {
-        size_t c = 0;
-
-        for (size_t j = 0; j < len; ++j) {
-            if (nums[j] == nums[i]) ++c;
-        }
+    if (n >= STAZ_PARALLEL_THRESHOLD && _staz_parallel_sort(nums, n)) return;
 
-        if (c > maxc) {
-            maxc = c;
-            maxv = nums[i];
-        }
-    }
-
-    return maxv;
+    _staz_sort_serial(nums, n);
 }
 
 /**
- * @brief Calculates different types of range for a numeric array
+ * @brief Calculates a quantile of an already sorted array
  * 
- * @param rtype Type of range calculation
- * @param nums Pointer to array of double values
+ * @param sorted Pointer to the sorted array of double values
  * @param len Length of the array
+ * @param mtype Quantile division
+ * @param posx Position of the quantile (range: 1 to mtype-1)
  * 
- * @return double The calculated range value
- *         NAN if input is invalid or calculation fails
+ * @return double The quantile, linearly interpolated between the two
+ *         closest ranks. It does not perform parameter validation.
+ */
+static double
+_staz_quantile_sorted(const double* sorted, size_t len, int mtype, size_t posx) {
+    const double index = posx * (len + 1) / (double)mtype;
+    const size_t lower = (size_t)index;
+
+    if (lower >= len) return sorted[len - 1];
+    if (lower == 0) return sorted[0];
+
+    return sorted[lower - 1] + (index - lower) * (sorted[lower] - sorted[lower - 1]);
+}
+
+/**
+ * @brief Calculates the median of an already sorted array
  * 
- * @note Supports multiple range calculation methods
- *       Sets errno to:
- *       - INVALID_PARAMETERS_ERROR if either array is NULL or len is 0
- *       - NAN_ERROR if a computed value is NAN
+ * @note It does not perform parameter validation.
  */
-double
-staz_range(staz_range_type rtype, double* nums, size_t len) {
-    if (!nums || len == 0) {
-        errno = INVALID_PARAMETERS_ERROR;
-        return NAN;
+static double
+_staz_median_sorted(const double* sorted, size_t len) {
+    const size_t middle = len / 2;
+
+    if (len % 2 != 0) return sorted[middle];
+
+    return (sorted[middle - 1] + sorted[middle]) / 2.0;
+}
+
+/** Arrays of at least this many values are searched by bucket selection */
+#ifndef STAZ_SELECT_THRESHOLD
+#define STAZ_SELECT_THRESHOLD (1u << 17)
+#endif
+
+/** Number of value buckets of the bucket selection */
+#define STAZ_SELECT_BUCKETS 1024
+
+/**
+ * @brief Finds the values at some ranks of the sorted order without sorting
+ * 
+ * @param nums Pointer to the array of double values
+ * @param len Length of the array, at least STAZ_SELECT_BUCKETS * STAZ_SAMPLE_OVERSAMPLING
+ * @param ranks Zero-based ranks to find, NANs ranking after every number
+ * @param count Number of ranks
+ * @param out Output array of count values
+ * 
+ * @return int 1 on success, 0 if the caller should fall back to a full sort
+ *         (the array is too small to sample, memory allocation failed or
+ *         the sample held too many NANs)
+ * 
+ * @note Splitters are picked from a sample, then all threads count their
+ *       block of the input per bucket. A second pass gathers only the few
+ *       buckets that hold a requested rank, which are then sorted.
+ */
+static int
+_staz_select_ranks(const double* nums, size_t len, const size_t* ranks, size_t count, double* out) {
+    const size_t k = STAZ_SELECT_BUCKETS; // bucket k collects the NANs
+    const size_t threads = _staz_num_threads();
+
+    if (len < k * STAZ_SAMPLE_OVERSAMPLING) return 0;
+
+    double* splitters = (double *)malloc((k - 1) * sizeof(double));
+    size_t* counts = (size_t *)calloc(threads * (k + 1) + 2 * (k + 2), sizeof(size_t));
+    unsigned char* needed = (unsigned char *)calloc(k + 1, 1);
+    double* gather = NULL;
+
+    if (!splitters || !counts || !needed || !_staz_pick_splitters(nums, len, k, splitters)) {
+        free(splitters);
+        free(counts);
+        free(needed);
+        return 0;
     }
 
-    errno = 0;
+    size_t* first = counts + threads * (k + 1); // global rank of the first value of each bucket
+    size_t* gbase = first + k + 2;              // offset of each needed bucket in gather
 
-    switch (rtype) {
-    case R_STANDARD: {
-        const double maxv = staz_max_value(nums, len);
-        const double minv = staz_min_value(nums, len);
+    STAZ_OMP(omp parallel num_threads(threads))
+    {
+#ifdef _OPENMP
+        const size_t t = (size_t)omp_get_thread_num();
+        const size_t nt = (size_t)omp_get_num_threads();
+#else
+        const size_t t = 0, nt = 1;
+#endif
+        const size_t begin = len * t / nt;
+        const size_t end = len * (t + 1) / nt;
+        size_t* mine = counts + t * (k + 1);
 
-        if (isnan(maxv) || isnan(minv)) {
-            errno = NAN_ERROR;
-            return NAN;
+        for (size_t i = begin; i < end; i++) {
+            const double x = nums[i];
+            mine[isnan(x) ? k : _staz_bucket_of(splitters, k - 1, x)]++;
         }
 
-        return maxv - minv;
+        STAZ_OMP(omp barrier)
+
+        STAZ_OMP(omp single)
+        {
+            size_t total = 0;
+
+            for (size_t b = 0; b <= k; b++) {
+                first[b] = total;
+                for (size_t u = 0; u < nt; u++) total += counts[u * (k + 1) + b];
+            }
+            first[k + 1] = total;
+
+            for (size_t r = 0; r < count; r++) {
+                needed[_staz_bucket_of_rank(first, k + 1, ranks[r])] = 1;
+            }
+
+            // Lay out the needed buckets back to back, thread by thread
+            total = 0;
+            for (size_t b = 0; b <= k; b++) {
+                if (!needed[b]) continue;
+
+                gbase[b] = total;
+                for (size_t u = 0; u < nt; u++) {
+                    const size_t c = counts[u * (k + 1) + b];
+                    counts[u * (k + 1) + b] = total;
+                    total += c;
+                }
+            }
+
+            gather = (double *)malloc((total ? total : 1) * sizeof(double));
+        }
+
+        if (gather) {
+            for (size_t i = begin; i < end; i++) {
+                const double x = nums[i];
+                const size_t b = isnan(x) ? k : _staz_bucket_of(splitters, k - 1, x);
+
+                if (needed[b]) gather[mine[b]++] = x;
+            }
+        }
     }
 
-    case R_INTERQUARTILE: {
-        const double q1 = staz_quantile(4, 1, nums, len);
-        const double q3 = staz_quantile(4, 3, nums, len);
+    const int ok = gather != NULL;
 
-        if (isnan(q1) || isnan(q3)) {
-            errno = NAN_ERROR;
-            return NAN;
+    if (ok) {
+        STAZ_OMP(omp parallel for schedule(dynamic, 1))
+        for (size_t b = 0; b <= k; b++) {
+            if (needed[b]) _staz_sort(gather + gbase[b], first[b + 1] - first[b]);
         }
 
-        return q3 - q1;
+        for (size_t r = 0; r < count; r++) {
+            const size_t b = _staz_bucket_of_rank(first, k + 1, ranks[r]);
+            out[r] = gather[gbase[b] + ranks[r] - first[b]];
+        }
     }
 
-    case R_PERCENTILE: {
-        const double p10 = staz_quantile(100, 10, nums, len);
-        const double p90 = staz_quantile(100, 90, nums, len);
+    free(splitters);
+    free(counts);
+    free(needed);
+    free(gather);
+    return ok;
+}
 
-        if (isnan(p10) || isnan(p90)) {
-            errno = NAN_ERROR;
-            return NAN;
+/**
+ * @brief Calculates several quantiles of the same array
+ * 
+ * @param nums Pointer to the array of double values
+ * @param len Length of the array
+ * @param mtype Quantile division
+ * @param posx Positions of the quantiles (range: 1 to mtype-1)
+ * @param count Number of quantiles
+ * @param out Output array of count quantiles
+ * 
+ * @return int 1 on success, 0 if memory allocation fails (errno is set)
+ * 
+ * @note Up to STAZ_SMALL_MAX values the array is sorted on the stack with
+ *       sorting networks, larger arrays are copied and sorted once, and
+ *       from STAZ_SELECT_THRESHOLD values up only the needed ranks are selected.
+ *       It does not perform parameter validation.
+ */
+static int
+_staz_quantiles(const double* nums, size_t len, int mtype, const size_t* posx, size_t count, double* out) {
+    if (len <= STAZ_SMALL_MAX) {
+        double sorted[STAZ_SMALL_MAX];
+        memcpy(sorted, nums, len * sizeof(double));
+        _staz_sort_tiny(sorted, len);
+
+        for (size_t i = 0; i < count; i++) {
+            out[i] = _staz_quantile_sorted(sorted, len, mtype, posx[i]);
         }
 
-        return p90 - p10;
+        return 1;
     }
 
-    default:
-        errno = INVALID_PARAMETERS_ERROR;
-        return NAN;
+    if (len >= STAZ_SELECT_THRESHOLD) {
+        size_t ranks[2 * 16];
+        double values[2 * 16];
+        size_t done = 0;
+
+        // Select in groups of 16 quantiles, each needing two ranks
+        while (done < count) {
+            const size_t group = (count - done < 16) ? count - done : 16;
+
+            for (size_t i = 0; i < group; i++) {
+                const size_t lower = (size_t)(posx[done + i] * (len + 1) / (double)mtype);
+
+                ranks[2 * i] = (lower == 0) ? 0 : (lower >= len) ? len - 1 : lower - 1;
+                ranks[2 * i + 1] = (lower >= len) ? len - 1 : lower;
+            }
+
+            if (!_staz_select_ranks(nums, len, ranks, 2 * group, values)) break;
+
+            for (size_t i = 0; i < group; i++) {
+                const double index = posx[done + i] * (len + 1) / (double)mtype;
+                const size_t lower = (size_t)index;
+
+                if (lower == 0 || lower >= len) {
+                    out[done + i] = values[2 * i];
+                } else {
+                    out[done + i] = values[2 * i] + (index - lower) * (values[2 * i + 1] - values[2 * i]);
+                }
+            }
+
+            done += group;
+        }
+
+        if (done == count) return 1;
+    }
+
+    double* sorted = copy_array(nums, len);
+    if (!sorted) return 0;
+
+    _staz_sort(sorted, len);
+
+    for (size_t i = 0; i < count; i++) {
+        out[i] = _staz_quantile_sorted(sorted, len, mtype, posx[i]);
     }
+
+    free(sorted);
+    return 1;
 }
 
+/* --- SHARED METHODS --- */
+
 /**
- * @brief Calculates the covariance between two arrays of values
- * 
- * Covariance measures how much two random variables vary together.
- * A positive value indicates that variables tend to move in the same direction,
- * while a negative value indicates they move in opposite directions.
+ * @brief Calculates the Pairwise summation of all elements in an array
  * 
- * @param x Pointer to the first array of double values
- * @param y Pointer to the second array of double values
- * @param len Length of both arrays (must be the same)
+ * @param nums Pointer to the array of double values
+ * @param len Length of the array
  * 
- * @return double The covariance between the two arrays
- *         NAN if either array is NULL or len is 0
+ * @return double The sum of all elements in the array
+ *         NAN if nums is NULL or len is 0
  * 
  * @note Sets errno to:
- *       - INVALID_PARAMETERS_ERROR if either array is NULL or len is 0
- *       - NAN_ERROR if mean of x or y is NAN
+ *       - INVALID_PARAMETERS_ERROR if nums is NULL or len is 0
  *       - 0 if operation succeeds
- *       - This calculates population covariance (dividing by n, not n-1)
  */
 double
-staz_covariance(double* x, double* y, size_t len) {
-    if (!x || !y || len == 0) {
+staz_sum(const double* nums, size_t len) {
+    if (!nums || len == 0) {
         errno = INVALID_PARAMETERS_ERROR;
         return NAN;
     }
 
     errno = 0;
 
-    const double mean_x = staz_mean(ARITHMETICAL, x, len);
-    const double mean_y = staz_mean(ARITHMETICAL, y, len);
-
-    if (isnan(mean_x) || isnan(mean_y)) {
-        errno = NAN_ERROR;
-        return NAN;
-    }
-
-    double nums[len];
-    
-    for (size_t i = 0; i < len; i++) {
-        nums[i] = (x[i] - mean_x) * (y[i] - mean_y);
-    }
-    
-    return staz_mean(ARITHMETICAL, nums, len);
+    return _staz_sum_recursive(nums, 0, len - 1);
 }
 
 /**
- * @brief Calculates the Pearson correlation coefficient between two arrays
- * 
- * Correlation coefficient measures the strength and direction of a linear 
- * relationship between two variables. Values range from -1 to 1, where:
- * 1  = perfect positive correlation
- * 0  = no correlation
- * -1 = perfect negative correlation
+ * @brief Calculates the sum of squares of all elements in an array
  * 
- * @param x Pointer to the first array of double values
- * @param y Pointer to the second array of double values
- * @param len Length of both arrays (must be the same)
+ * @param nums Pointer to the array of double values
+ * @param len Length of the array
  * 
- * @return double The correlation coefficient between the two arrays
- *         NAN if either array is NULL or len is 0
- *         NAN if either array has zero standard deviation
+ * @return double The sum of squares of all elements
+ *         NAN if nums is NULL or len is 0
  * 
  * @note Sets errno to:
- *       - INVALID_PARAMETERS_ERROR if either array is NULL or len is 0
- *       - NAN_ERROR if either array has NAN standard deviation or coviariance is NAN
- *       - ZERO_DIVISION_ERROR if either array has zero standard deviation
+ *       - INVALID_PARAMETERS_ERROR if nums is NULL or len is 0
  *       - 0 if operation succeeds
  */
 double
-staz_correlation(double* x, double* y, size_t len) {
-    if (!x || !y || len == 0) {
+staz_quadratic_sum(const double* nums, size_t len) {
+    if (!nums || len == 0) {
         errno = INVALID_PARAMETERS_ERROR;
         return NAN;
     }
 
     errno = 0;
 
-    const double cov = staz_covariance(x, y, len);
-    const double dev_x = staz_deviation(D_STANDARD, x, len);
-    const double dev_y = staz_deviation(D_STANDARD, y, len);
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    size_t i = 0;
 
-    if (isnan(cov) || isnan(dev_x) || isnan(dev_y)) {
-        errno = NAN_ERROR;
-        return NAN;
+    // Sum squares of all values in array, four lanes at a time
+    for (; i + 4 <= len; i += 4) {
+        s0 += nums[i] * nums[i];
+        s1 += nums[i + 1] * nums[i + 1];
+        s2 += nums[i + 2] * nums[i + 2];
+        s3 += nums[i + 3] * nums[i + 3];
     }
-
-    if (dev_x == 0.0 || dev_y == 0.0) {
-        errno = ZERO_DIVISION_ERROR;
-        return NAN;
+    for (; i < len; i++) {
+        s0 += nums[i] * nums[i];
     }
 
-    return cov / (dev_x * dev_y);
+    return (s0 + s1) + (s2 + s3);
 }
 
 /**
- * @brief Calculates the boxplot information for a numeric array.
- *
- * @param nums Pointer to the array of double values.
- * @param len Length of the array.
- *
- * @return staz_boxplot_info Structure containing the Q3, median, Q1, upper whisker, lower whisker, upper outlier, and lower outlier.
- *
+ * @brief Calculates the product of all elements in an array
+ * 
+ * @param nums Pointer to the array of double values
+ * @param len Length of the array
+ * 
+ * @return double The product of all elements
+ *         NAN if nums is NULL or len is 0
+ * 
  * @note Sets errno to:
- *    - INVALID_PARAMETERS_ERROR if nums is NULL or len is 0.
- *    - 0 if operation succeeds.
+ *       - INVALID_PARAMETERS_ERROR if nums is NULL or len is 0
+ *       - 0 if operation succeeds
+ *       - Stops calculation early if product becomes 0
  */
-staz_boxplot_info
-staz_boxplot(double* nums, size_t len) {
+double
+staz_prod(const double* nums, size_t len) {
     if (!nums || len == 0) {
         errno = INVALID_PARAMETERS_ERROR;
-        return (staz_boxplot_info) {NAN, NAN, NAN, NAN, NAN, NAN, NAN};
+        return NAN;
     }
 
     errno = 0;
 
-    const double q1 = staz_quantile(4, 1, nums, len);
-    const double q3 = staz_quantile(4, 3, nums, len);
-
-    const double med = staz_median(nums, len);
-    const double iqr = q3 - q1;
-
-    const double upper_whisker = q3 + 1.5 * iqr;
-    const double lower_whisker = q1 - 1.5 * iqr;
+    double product = 1.0;
 
-    const double upper_outlier = staz_max_value(nums, len);
-    const double lower_outlier = staz_min_value(nums, len);
+    // Multiply all values of array
+    for (size_t i = 0; i < len; i++) {
+        product *= nums[i];
+        if (product == 0.0) break;  // Early termination optimization
+    }
 
-    return (staz_boxplot_info) {
-        q3,
-        med,
-        q1,
-        upper_whisker,
-        lower_whisker,
-        upper_outlier,
-        lower_outlier
-    };
+    return product;
 }
 
 /**
- * @brief Performs linear regression on two arrays of points
- * 
- * @param x Pointer to the array of x coordinates
- * @param y Pointer to the array of y coordinates
- * @param len Length of both arrays (must be the same)
+ * @brief Finds the minimum value in an array
  * 
- * @return lineEquation Structure containing m (slope) and q (y-intercept)
- *         representing the best-fit line y = mx + q
+ * @param nums Pointer to the array of double values
+ * @param len Length of the array
  * 
- * @note Both arrays must have the same length
- * @note Inherits errno settings from the staz_sum() function
+ * @return double The minimum value in the array
+ *         NAN if nums is NULL or len is 0
  * 
  * @note Sets errno to:
- *    - INVALID_PARAMETERS_ERROR if x or y is NULL or len is 0
- *    - ZERO_DIVISION_ERROR if divisor of m is zero
- *    - 0 if operation succeeds
+ *       - INVALID_PARAMETERS_ERROR if nums is NULL or len is 0
+ *       - 0 if operation succeeds
  */
-staz_line_equation
-staz_linear_regression(const double* x, const double* y, size_t len) {
-    if (!x || !y || len == 0) {
+double
+staz_min_value(const double* nums, size_t len) {
+    if (!nums || len == 0) {
         errno = INVALID_PARAMETERS_ERROR;
-        return (staz_line_equation) {NAN, NAN};
+        return NAN;
     }
 
     errno = 0;
 
-    const double sum_x = staz_sum(x, len);
-    const double sum_y = staz_sum(y, len);
-
-    double sum_xy = 0, sum_x_sq = 0;
-
-    for (size_t i = 0; i < len; i++) {
-        sum_xy += x[i] * y[i];
-        sum_x_sq += x[i] * x[i];
-    }
+    double min = nums[0];
 
-    const double d_of_m = len * sum_x_sq - sum_x * sum_x;
-    if (d_of_m == 0) {
-        errno = ZERO_DIVISION_ERROR;
-        return (staz_line_equation) {NAN, NAN};
+    for (size_t i = 1; i < len; i++) {
+        if (nums[i] < min) min = nums[i];
     }
 
-    const double m = (len * sum_xy - sum_x * sum_y) / d_of_m;
-    const double q = (sum_y - m * sum_x) / len;
+    return min;
+}
+
+/**
+ * @brief Finds the maximum value in an array
+ * 
+ * @param nums Pointer to the array of double values
+ * @param len Length of the array
+ * 
+ * @return double The maximum value in the array
+ *         NAN if nums is NULL or len is 0
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if nums is NULL or len is 0
+ *       - 0 if operation succeeds
+ */
+double
+staz_max_value(const double* nums, size_t len) {
+    if (!nums || len == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    errno = 0;
+
+    double max = nums[0];
+
+    for (size_t i = 1; i < len; i++) {
+        if (nums[i] > max) max = nums[i];
+    }
+
+    return max;
+}
+
+/* --- PUBLIC METHODS --- */
+
+/**
+ * @brief Enumeration of different mean types supported by the library
+ */
+typedef enum {
+    ARITHMETICAL, /** Arithmetic mean (average) */
+    GEOMETRICAL,  /** Geometric mean (nth root of product) */
+    HARMONICAL,   /** Harmonic mean (reciprocal of average of reciprocals) */
+    QUADRATICAL,  /** Quadratic mean (root mean square) */
+    EXTREMES,     /** Mean of extreme values (min and max) */
+    TRIMEAN,      /** The Tukey's mean */
+    MIDHINGE      /** Mean of Q1 and Q2 */
+} staz_mean_type;
+
+/**
+ * @brief Enumeration of different range types supported by the library
+ */
+typedef enum {
+    R_STANDARD,      /** Standard range */
+    R_INTERQUARTILE, /** Interquartile range (IQR) */
+    R_PERCENTILE,    /** Percentile range */
+} staz_range_type;
+
+/**
+ * @brief Enum for different deviation calculation methods
+ */
+typedef enum {
+    D_STANDARD, /** Standard deviation from mean */
+    D_AVERAGE,  /** Average deviation method */
+    D_RELATIVE, /** Relative deviation calculation */
+    D_MAD_AVG,  /** Mean Absolute Deviation from average */
+    D_MAD_MED,  /** Mean Absolute Deviation from median */
+} staz_deviation_type;
+
+/**
+ * @brief Structure representing the information required to draw a boxplot.
+ */
+typedef struct {
+    double BOX_HIGH;          /** Q3 */
+    double BOX_CENTRE;        /** Median */
+    double BOX_LOW;           /** Q1 */
+    double BOX_UPPER_WHISKER; /** Q3 + 1.5 * iqr */
+    double BOX_LOWER_WHISKER; /** Q1 - 1.5 * iqr */
+    double BOX_UPPER_OUTLIER; /** max */
+    double BOX_LOWER_OUTLIER; /** min */
+} staz_boxplot_info;
+
+/**
+ * @brief Structure representing a linear equation in the form y = mx + q
+ */
+typedef struct {
+    double m; /** Slope of the line (coefficient of x) */
+    double q; /** Y-intercept (constant term) */
+} staz_line_equation;
+
+/**
+ * @brief Calculates the median value
+ * 
+ * @param nums Pointer to the array of double values
+ * @param len Length of the array
+ * 
+ * @return double The median value of the array
+ *         - For odd-sized arrays: middle element
+ *         - For even-sized arrays: average of the two middle elements
+ *         - NAN if nums is NULL or len is 0
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if nums is NULL or len is 0
+ *       - 0 if operation succeeds
+ */
+double
+staz_median(double* nums, size_t len) {
+    if (!nums || len == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    errno = 0;
+
+    if (len <= STAZ_SMALL_MAX) {
+        double buf[STAZ_SMALL_MAX];
+        memcpy(buf, nums, len * sizeof(double));
+        _staz_sort_tiny(buf, len);
+
+        return _staz_median_sorted(buf, len);
+    }
+
+    double* sorted = copy_array(nums, len);
+    if (!sorted) return NAN;
+
+    _staz_sort(sorted, len);
+
+    const double med = _staz_median_sorted(sorted, len);
+
+    free(sorted);
+    return med;
+}
+
+/**
+ * @brief Calculates the quantile for a numeric array
+ * 
+ * @param mtype Quantile division (e.g., 1000, 20, 30, 4)
+ * @param nums Pointer to array of double values
+ * @param len Length of the array
+ * @param posx Position of the quantile (range: 1 to mtype-1)
+ * 
+ * @return double The calculated quantile value
+ *         NAN if input is invalid
+ *
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if nums is NULL or len or posx is invalid
+ *       - RANGEOUT_ERROR if mtype is invalid for len of nums
+ *       - 0 if operation succeeds
+ * 
+ * @note Calculates quantile using linear interpolation method
+ */
+double
+staz_quantile(int mtype, size_t posx, double* nums, size_t len) {
+    if (!nums || len == 0 || posx < 1) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    /* Measure type must be between 1 and mtype-1 */
+    if (posx > (size_t)mtype - 1) {
+        errno = RANGEOUT_ERROR;
+        return NAN;
+    }
+
+    errno = 0;
+
+    double qu;
+    if (!_staz_quantiles(nums, len, mtype, &posx, 1, &qu)) return NAN;
+
+    return qu;
+}
+
+/**
+ * @brief Calculates several quantiles of the same numeric array at once
+ * 
+ * @param mtype Quantile division (e.g., 1000, 20, 30, 4)
+ * @param posx Array of quantile positions (range: 1 to mtype-1)
+ * @param count Number of positions
+ * @param nums Pointer to array of double values
+ * @param len Length of the array
+ * @param out Output array of count quantiles, set to NAN on error
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if nums, posx or out is NULL, len or count is 0 or a posx is 0
+ *       - RANGEOUT_ERROR if a posx is invalid for mtype
+ *       - MEMORY_ALLOCATION_ERROR if memory allocation fails
+ *       - 0 if operation succeeds
+ * 
+ * @note Same interpolation as staz_quantile, but the array is sorted (or,
+ *       for large arrays, scanned by bucket selection) only once.
+ */
+void
+staz_quantiles(int mtype, const size_t* posx, size_t count, double* nums, size_t len, double* out) {
+    if (!out) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) out[i] = NAN;
+
+    if (!nums || !posx || len == 0 || count == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (posx[i] < 1) {
+            errno = INVALID_PARAMETERS_ERROR;
+            return;
+        }
+
+        /* Measure type must be between 1 and mtype-1 */
+        if (posx[i] > (size_t)mtype - 1) {
+            errno = RANGEOUT_ERROR;
+            return;
+        }
+    }
+
+    errno = 0;
+
+    _staz_quantiles(nums, len, mtype, posx, count, out);
+}
+
+/**
+ * @brief Calculates different types of means for an array of values
+ * 
+ * @param mtype The type of mean to calculate (from MeanType enum)
+ * @param nums Pointer to the array of double values
+ * @param len Length of the array
+ * 
+ * @return double The calculated mean value
+ *         NAN if:
+ *         - nums is NULL or len is 0
+ *         - GEOMETRICAL mean with negative product
+ *         - HARMONICAL mean with any element = 0
+ *         - V_OF_EXTREME with len < 2
+ *         - Invalid mtype provided
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if nums is NULL, len is 0, or invalid mtype
+ *       - MATH_DOMAIN_ERROR for mathematical domain errors
+ *       - 0 if operation succeeds
+ */
+double
+staz_mean(staz_mean_type mtype, double* nums, size_t len) {
+    if (!nums || len == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    errno = 0;
+
+    switch (mtype) {
+    case ARITHMETICAL:
+        return staz_sum(nums, len) / len;
+
+    case GEOMETRICAL: {
+        const double prod_value = staz_prod(nums, len);
+        if (prod_value == 0) return 0.0;
+        if (prod_value < 0) {
+            errno = MATH_DOMAIN_ERROR;
+            return NAN;
+        }
+
+        return staz_sqrti(len, prod_value);
+    }
+        
+    case HARMONICAL: {
+        const double recp_sum = _sum_recp(nums, len);
+        if (isnan(recp_sum)) return NAN;
+
+        return len / recp_sum;
+    }
+
+    case QUADRATICAL:
+        return sqrt(staz_quadratic_sum(nums, len) / len);
+
+    case EXTREMES: {
+        if (len < 2) {
+            errno = INVALID_PARAMETERS_ERROR;
+            return NAN;
+        }
+
+        return (staz_min_value(nums, len) + staz_max_value(nums, len)) / 2.0;
+    }
+
+    case TRIMEAN: {
+        const size_t posx[3] = {1, 2, 3};
+        double q[3];
+        staz_quantiles(4, posx, 3, nums, len, q);
+
+        return (q[0] + 2 * q[1] + q[2]) / 4.0;
+    }
+
+    case MIDHINGE: {
+        const size_t posx[2] = {1, 3};
+        double q[2];
+        staz_quantiles(4, posx, 2, nums, len, q);
+
+        return (q[0] + q[1]) / 2;
+    }
+
+    default:
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+}
+
+/**
+ * @brief Calculates the variance of values in an array
+ * 
+ * @param nums Pointer to the array of double values
+ * @param len Length of the array
+ * 
+ * @return double The variance of the values
+ *         NAN if nums is NULL or len is 0
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if nums is NULL or len is 0
+ *       - NAN_ERROR if computed value of mean is NAN
+ *       - 0 if operation succeeds
+ *       - This calculates population variance (dividing by n, not n-1)
+ */
+double
+staz_variance(double* nums, size_t len) {
+    if (!nums || len == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    errno = 0;
+
+    const double mean_value = staz_mean(ARITHMETICAL, nums, len);
+
+    if (isnan(mean_value)) {
+        errno = NAN_ERROR;
+        return NAN;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        const double diff = nums[i] - mean_value;
+        nums[i] = diff * diff;
+    }
+
+    return staz_mean(ARITHMETICAL, nums, len);
+}
+
+/**
+ * This function supports multiple deviation metrics:
+ * - Standard deviation: square root of variance
+ * - Relative deviation: standard deviation divided by mean (coefficient of variation)
+ * - Mean absolute deviation: average of absolute deviations from the mean
+ * - Median absolute deviation: median of absolute deviations from the median
+ * 
+ * @param dtype Type of deviation to calculate (from staz_deviation_type enum)
+ * @param nums Pointer to the array of double values
+ * @param len Length of the array
+ * 
+ * @return double The calculated deviation value
+ *         NAN if:
+ *         - nums is NULL or len is 0
+ *         - RELATIVE deviation when mean equals zero
+ *         - Memory allocation fails for MAD_MED
+ *         - Invalid dtype provided
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if nums is NULL, len is 0, or invalid dtype
+ *       - NAN_ERROR or ZERO_DIVISION_ERROR if computed values is NAN or zero
+ *       - MEMORY_ALLOCATION_ERROR if memory allocation fails for MAD_MED
+ *       - 0 if operation succeeds
+ */
+double
+staz_deviation(staz_deviation_type dtype, double* nums, size_t len) {
+    if (!nums || len == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    errno = 0;
+
+    switch (dtype) {
+    case D_STANDARD: {
+        const double variance_value = staz_variance(nums, len);
+
+        if (isnan(variance_value)) {
+            errno = NAN_ERROR;
+            return NAN;
+        }
+
+        return sqrt(variance_value);
+    }
+    
+    case D_RELATIVE: {
+        const double meanv = staz_mean(ARITHMETICAL, nums, len);
+        if (isnan(meanv)) {
+            errno = NAN_ERROR;
+            return NAN;
+        } else if (meanv == 0) {
+            errno = ZERO_DIVISION_ERROR;
+            return NAN;
+        }
+
+        return staz_deviation(D_STANDARD, nums, len) / meanv;
+    }
+    
+    case D_MAD_AVG: {
+        const double meanv = staz_mean(ARITHMETICAL, nums, len);
+
+        for (size_t i = 0; i < len; i++) {
+            nums[i] = fabs(nums[i] - meanv);
+        }
+        
+        return staz_mean(ARITHMETICAL, nums, len);
+    }
+
+    case D_MAD_MED: {
+        const double medv = staz_median(nums, len);
+
+        for (size_t i = 0; i < len; i++) {
+            nums[i] = fabs(nums[i] - medv);
+        }
+
+        return staz_mean(ARITHMETICAL, nums, len);
+    }
+
+    default:
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+}
+
+/**
+ * @brief Calculates the mode (most frequent value) of values in an array
+ * 
+ * @param nums Pointer to the array of double values
+ * @param len Length of the array
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if nums is NULL or len is 0
+ *       - 0 if operation succeeds
+ */
+double
+staz_mode(const double* nums, size_t len) {
+    if (!nums || len == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    errno = 0;
+
+    double maxv = 0, maxc = 0;
+
+    for (size_t i = 0; i < len; ++i) {
+        size_t c = 0;
+
+        for (size_t j = 0; j < len; ++j) {
+            if (nums[j] == nums[i]) ++c;
+        }
+
+        if (c > maxc) {
+            maxc = c;
+            maxv = nums[i];
+        }
+    }
+
+    return maxv;
+}
+
+/**
+ * @brief Calculates different types of range for a numeric array
+ * 
+ * @param rtype Type of range calculation
+ * @param nums Pointer to array of double values
+ * @param len Length of the array
+ * 
+ * @return double The calculated range value
+ *         NAN if input is invalid or calculation fails
+ * 
+ * @note Supports multiple range calculation methods
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if either array is NULL or len is 0
+ *       - NAN_ERROR if a computed value is NAN
+ */
+double
+staz_range(staz_range_type rtype, double* nums, size_t len) {
+    if (!nums || len == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    errno = 0;
+
+    switch (rtype) {
+    case R_STANDARD: {
+        const double maxv = staz_max_value(nums, len);
+        const double minv = staz_min_value(nums, len);
+
+        if (isnan(maxv) || isnan(minv)) {
+            errno = NAN_ERROR;
+            return NAN;
+        }
+
+        return maxv - minv;
+    }
+
+    case R_INTERQUARTILE: {
+        const size_t posx[2] = {1, 3};
+        double q[2];
+        staz_quantiles(4, posx, 2, nums, len, q);
+
+        const double q1 = q[0], q3 = q[1];
+
+        if (isnan(q1) || isnan(q3)) {
+            errno = NAN_ERROR;
+            return NAN;
+        }
+
+        return q3 - q1;
+    }
+
+    case R_PERCENTILE: {
+        const size_t posx[2] = {10, 90};
+        double p[2];
+        staz_quantiles(100, posx, 2, nums, len, p);
+
+        const double p10 = p[0], p90 = p[1];
+
+        if (isnan(p10) || isnan(p90)) {
+            errno = NAN_ERROR;
+            return NAN;
+        }
+
+        return p90 - p10;
+    }
+
+    default:
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+}
+
+/**
+ * @brief Calculates the covariance between two arrays of values
+ * 
+ * Covariance measures how much two random variables vary together.
+ * A positive value indicates that variables tend to move in the same direction,
+ * while a negative value indicates they move in opposite directions.
+ * 
+ * @param x Pointer to the first array of double values
+ * @param y Pointer to the second array of double values
+ * @param len Length of both arrays (must be the same)
+ * 
+ * @return double The covariance between the two arrays
+ *         NAN if either array is NULL or len is 0
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if either array is NULL or len is 0
+ *       - NAN_ERROR if mean of x or y is NAN
+ *       - 0 if operation succeeds
+ *       - This calculates population covariance (dividing by n, not n-1)
+ */
+double
+staz_covariance(double* x, double* y, size_t len) {
+    if (!x || !y || len == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    errno = 0;
+
+    const double mean_x = staz_mean(ARITHMETICAL, x, len);
+    const double mean_y = staz_mean(ARITHMETICAL, y, len);
+
+    if (isnan(mean_x) || isnan(mean_y)) {
+        errno = NAN_ERROR;
+        return NAN;
+    }
+
+    double nums[len];
+    
+    for (size_t i = 0; i < len; i++) {
+        nums[i] = (x[i] - mean_x) * (y[i] - mean_y);
+    }
+    
+    return staz_mean(ARITHMETICAL, nums, len);
+}
+
+/**
+ * @brief Calculates the Pearson correlation coefficient between two arrays
+ * 
+ * Correlation coefficient measures the strength and direction of a linear 
+ * relationship between two variables. Values range from -1 to 1, where:
+ * 1  = perfect positive correlation
+ * 0  = no correlation
+ * -1 = perfect negative correlation
+ * 
+ * @param x Pointer to the first array of double values
+ * @param y Pointer to the second array of double values
+ * @param len Length of both arrays (must be the same)
+ * 
+ * @return double The correlation coefficient between the two arrays
+ *         NAN if either array is NULL or len is 0
+ *         NAN if either array has zero standard deviation
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if either array is NULL or len is 0
+ *       - NAN_ERROR if either array has NAN standard deviation or coviariance is NAN
+ *       - ZERO_DIVISION_ERROR if either array has zero standard deviation
+ *       - 0 if operation succeeds
+ */
+double
+staz_correlation(double* x, double* y, size_t len) {
+    if (!x || !y || len == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    errno = 0;
+
+    const double cov = staz_covariance(x, y, len);
+    const double dev_x = staz_deviation(D_STANDARD, x, len);
+    const double dev_y = staz_deviation(D_STANDARD, y, len);
+
+    if (isnan(cov) || isnan(dev_x) || isnan(dev_y)) {
+        errno = NAN_ERROR;
+        return NAN;
+    }
+
+    if (dev_x == 0.0 || dev_y == 0.0) {
+        errno = ZERO_DIVISION_ERROR;
+        return NAN;
+    }
+
+    return cov / (dev_x * dev_y);
+}
+
+/**
+ * @brief Calculates the boxplot information for a numeric array.
+ *
+ * @param nums Pointer to the array of double values.
+ * @param len Length of the array.
+ *
+ * @return staz_boxplot_info Structure containing the Q3, median, Q1, upper whisker, lower whisker, upper outlier, and lower outlier.
+ *
+ * @note Sets errno to:
+ *    - INVALID_PARAMETERS_ERROR if nums is NULL or len is 0.
+ *    - MEMORY_ALLOCATION_ERROR if memory allocation fails.
+ *    - 0 if operation succeeds.
+ * 
+ * @note The array is copied and sorted once for all three quartiles.
+ */
+staz_boxplot_info
+staz_boxplot(double* nums, size_t len) {
+    if (!nums || len == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return (staz_boxplot_info) {NAN, NAN, NAN, NAN, NAN, NAN, NAN};
+    }
+
+    errno = 0;
+
+    double* sorted = copy_array(nums, len);
+    if (!sorted) return (staz_boxplot_info) {NAN, NAN, NAN, NAN, NAN, NAN, NAN};
+
+    _staz_sort(sorted, len);
+
+    const double q1 = _staz_quantile_sorted(sorted, len, 4, 1);
+    const double q3 = _staz_quantile_sorted(sorted, len, 4, 3);
+    const double med = _staz_median_sorted(sorted, len);
+
+    free(sorted);
+
+    const double iqr = q3 - q1;
+
+    const double upper_whisker = q3 + 1.5 * iqr;
+    const double lower_whisker = q1 - 1.5 * iqr;
+
+    const double upper_outlier = staz_max_value(nums, len);
+    const double lower_outlier = staz_min_value(nums, len);
+
+    return (staz_boxplot_info) {
+        q3,
+        med,
+        q1,
+        upper_whisker,
+        lower_whisker,
+        upper_outlier,
+        lower_outlier
+    };
+}
+
+/** Pairs reduced at a time by _staz_comoments2, small enough to stay in L1 */
+#ifndef STAZ_COMOMENTS_BLOCK
+#define STAZ_COMOMENTS_BLOCK 512
+#endif
+
+/**
+ * @brief Count, means and centered second co-moments of paired samples
+ */
+typedef struct {
+    size_t n;      /** Number of pairs */
+    double mean_x; /** Mean of x */
+    double mean_y; /** Mean of y */
+    double sxx;    /** Sum of (x - mean_x)^2 */
+    double syy;    /** Sum of (y - mean_y)^2 */
+    double sxy;    /** Sum of (x - mean_x) * (y - mean_y) */
+} _staz_moments2;
+
+/**
+ * @brief Folds the co-moments of b into a (Chan et al.)
+ */
+static inline void
+_staz_moments2_merge(_staz_moments2* a, const _staz_moments2* b) {
+    if (b->n == 0) return;
+    if (a->n == 0) {
+        *a = *b;
+        return;
+    }
+
+    const double na = (double)a->n, nb = (double)b->n;
+    const double n = na + nb;
+    const double dx = b->mean_x - a->mean_x, dy = b->mean_y - a->mean_y;
+    const double w = na * nb / n;
+
+    a->mean_x += dx * (nb / n);
+    a->mean_y += dy * (nb / n);
+    a->sxx += b->sxx + dx * dx * w;
+    a->syy += b->syy + dy * dy * w;
+    a->sxy += b->sxy + dx * dy * w;
+    a->n += b->n;
+}
+
+/**
+ * @brief Error-free sum: returns a + b rounded, with the rounding error in *err (Knuth)
+ */
+static inline double
+_staz_two_sum(double a, double b, double* err) {
+    const double s = a + b;
+    const double z = s - a;
+    *err = (a - (s - z)) + (b - z);
+    return s;
+}
+
+/**
+ * @brief Error-free product: returns a * b rounded, with the rounding error in *err
+ * 
+ * @note One fused multiply-add where the target has it, Dekker's
+ *       splitting otherwise (a software fma would be far slower).
+ */
+static inline double
+_staz_two_prod(double a, double b, double* err) {
+    const double p = a * b;
+#ifdef FP_FAST_FMA
+    *err = fma(a, b, -p);
+#else
+    const double split = 134217729.0; // 2^27 + 1
+    const double ca = split * a, cb = split * b;
+    const double ah = ca - (ca - a), bh = cb - (cb - b);
+    const double al = a - ah, bl = b - bh;
+    *err = ((ah * bh - p) + ah * bl + al * bh) + al * bl;
+#endif
+    return p;
+}
+
+/**
+ * @brief One Dot2 step: adds a * b to the sum *s, collecting both rounding errors in *c
+ */
+static inline void
+_staz_dot2_step(double* s, double* c, double a, double b) {
+    double e, q;
+    const double p = _staz_two_prod(a, b, &e);
+    *s = _staz_two_sum(*s, p, &q);
+    *c += e + q;
+}
+
+/**
+ * @brief Two-pass co-moments of one block with compensated sums and dot products
+ * 
+ * @note Values are taken relative to (x0, y0), and so are the means.
+ *       The means are compensated sums and the centered co-moments are
+ *       Dot2 products (Ogita, Rump and Oishi): every addition and product
+ *       keeps its rounding error, so each result is as accurate as if
+ *       computed in twice the working precision. Four independent lanes
+ *       leave the loops free to vectorize; this relies on the compiler not
+ *       reassociating floating point (no -ffast-math).
+ */
+static inline _staz_moments2
+_staz_moments2_block(const double* x, const double* y, size_t n, double x0, double y0) {
+    double sx[4] = {0.0, 0.0, 0.0, 0.0}, ex[4] = {0.0, 0.0, 0.0, 0.0};
+    double sy[4] = {0.0, 0.0, 0.0, 0.0}, ey[4] = {0.0, 0.0, 0.0, 0.0};
+    const size_t body = n & ~(size_t)3;
+    double e;
+
+    for (size_t i = 0; i < body; i += 4) {
+        for (size_t l = 0; l < 4; l++) {
+            sx[l] = _staz_two_sum(sx[l], x[i + l] - x0, &e);
+            ex[l] += e;
+            sy[l] = _staz_two_sum(sy[l], y[i + l] - y0, &e);
+            ey[l] += e;
+        }
+    }
+    for (size_t i = body; i < n; i++) {
+        sx[0] = _staz_two_sum(sx[0], x[i] - x0, &e);
+        ex[0] += e;
+        sy[0] = _staz_two_sum(sy[0], y[i] - y0, &e);
+        ey[0] += e;
+    }
+
+    double tx = 0.0, cx = 0.0, ty = 0.0, cy = 0.0;
+    for (size_t l = 0; l < 4; l++) {
+        tx = _staz_two_sum(tx, sx[l], &e);
+        cx += e + ex[l];
+        ty = _staz_two_sum(ty, sy[l], &e);
+        cy += e + ey[l];
+    }
+
+    const double mx = (tx + cx) / n;
+    const double my = (ty + cy) / n;
+
+    // Dot2 lanes: running sums s and accumulated errors c of the products
+    double sxx[4] = {0.0, 0.0, 0.0, 0.0}, cxx[4] = {0.0, 0.0, 0.0, 0.0};
+    double syy[4] = {0.0, 0.0, 0.0, 0.0}, cyy[4] = {0.0, 0.0, 0.0, 0.0};
+    double sxy[4] = {0.0, 0.0, 0.0, 0.0}, cxy[4] = {0.0, 0.0, 0.0, 0.0};
+
+    for (size_t i = 0; i < body; i += 4) {
+        for (size_t l = 0; l < 4; l++) {
+            const double dx = (x[i + l] - x0) - mx, dy = (y[i + l] - y0) - my;
+            _staz_dot2_step(&sxx[l], &cxx[l], dx, dx);
+            _staz_dot2_step(&syy[l], &cyy[l], dy, dy);
+            _staz_dot2_step(&sxy[l], &cxy[l], dx, dy);
+        }
+    }
+    for (size_t i = body; i < n; i++) {
+        const double dx = (x[i] - x0) - mx, dy = (y[i] - y0) - my;
+        _staz_dot2_step(&sxx[0], &cxx[0], dx, dx);
+        _staz_dot2_step(&syy[0], &cyy[0], dy, dy);
+        _staz_dot2_step(&sxy[0], &cxy[0], dx, dy);
+    }
+
+    _staz_moments2 m = {n, mx, my, 0.0, 0.0, 0.0};
+    double txx = 0.0, tyy = 0.0, txy = 0.0;
+    double rxx = 0.0, ryy = 0.0, rxy = 0.0;
+
+    for (size_t l = 0; l < 4; l++) {
+        txx = _staz_two_sum(txx, sxx[l], &e);
+        rxx += e + cxx[l];
+        tyy = _staz_two_sum(tyy, syy[l], &e);
+        ryy += e + cyy[l];
+        txy = _staz_two_sum(txy, sxy[l], &e);
+        rxy += e + cxy[l];
+    }
+
+    m.sxx = txx + rxx;
+    m.syy = tyy + ryy;
+    m.sxy = txy + rxy;
+    return m;
+}
+
+/**
+ * @brief Means and centered co-moments of two arrays in a single read
+ * 
+ * @note Every block is reduced with two passes while it sits in cache and
+ *       folded in with Chan's update, so the co-moments are as accurate
+ *       as a two-pass computation on offset data (timestamps, prices).
+ *       Large inputs are split in one contiguous range per thread, and
+ *       the partial results are merged in order, so the result does not
+ *       depend on scheduling.
+ */
+static _staz_moments2
+_staz_comoments2(const double* x, const double* y, size_t len) {
+    _staz_moments2 total = {0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    size_t threads = _staz_num_threads();
+    _staz_moments2* parts = NULL;
+
+    if (threads > 1 && len >= STAZ_PARALLEL_THRESHOLD) {
+        parts = (_staz_moments2 *)calloc(threads, sizeof(_staz_moments2));
+    }
+    if (!parts) threads = 1;
+
+    // Shifting by the first pair keeps the block means (and so the Chan
+    // corrections between blocks) small on offset data like timestamps
+    const double x0 = (len > 0) ? x[0] : 0.0;
+    const double y0 = (len > 0) ? y[0] : 0.0;
+
+    STAZ_OMP(omp parallel for schedule(static) num_threads(threads) if (threads > 1))
+    for (size_t t = 0; t < threads; t++) {
+        const size_t begin = len * t / threads;
+        const size_t end = len * (t + 1) / threads;
+        _staz_moments2 acc = {0, 0.0, 0.0, 0.0, 0.0, 0.0};
+
+        for (size_t i = begin; i < end; i += STAZ_COMOMENTS_BLOCK) {
+            const size_t n = (end - i < STAZ_COMOMENTS_BLOCK) ? end - i : STAZ_COMOMENTS_BLOCK;
+            const _staz_moments2 b = _staz_moments2_block(x + i, y + i, n, x0, y0);
+            _staz_moments2_merge(&acc, &b);
+        }
+
+        if (parts) parts[t] = acc;
+        else total = acc;
+    }
+
+    if (parts) {
+        for (size_t t = 0; t < threads; t++) _staz_moments2_merge(&total, &parts[t]);
+        free(parts);
+    }
+
+    total.mean_x += x0;
+    total.mean_y += y0;
+    return total;
+}
+
+/**
+ * @brief Performs linear regression on two arrays of points
+ * 
+ * @param x Pointer to the array of x coordinates
+ * @param y Pointer to the array of y coordinates
+ * @param len Length of both arrays (must be the same)
+ * 
+ * @return lineEquation Structure containing m (slope) and q (y-intercept)
+ *         representing the best-fit line y = mx + q
+ * 
+ * @note Both arrays must have the same length
+ * @note The slope is SXY / SXX over centered co-moments accumulated with
+ *       compensated (Dot2) sums, so offset data such as timestamps around
+ *       1.7e9 keeps full accuracy without centering it beforehand.
+ * 
+ * @note Sets errno to:
+ *    - INVALID_PARAMETERS_ERROR if x or y is NULL or len is 0
+ *    - ZERO_DIVISION_ERROR if divisor of m is zero
+ *    - 0 if operation succeeds
+ */
+staz_line_equation
+staz_linear_regression(const double* x, const double* y, size_t len) {
+    if (!x || !y || len == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return (staz_line_equation) {NAN, NAN};
+    }
+
+    const _staz_moments2 mom = _staz_comoments2(x, y, len);
+
+    if (mom.sxx == 0) {
+        errno = ZERO_DIVISION_ERROR;
+        return (staz_line_equation) {NAN, NAN};
+    }
+
+    errno = 0;
+
+    const double m = mom.sxy / mom.sxx;
+    const double q = mom.mean_y - m * mom.mean_x;
+
+    return (staz_line_equation) {
+        m,
+        q
+    };
+}
+
+/* --- DATASET --- */
+
+/**
+ * @brief Flags of the derived state currently cached by a staz_dataset
+ */
+typedef enum {
+    STAZ_DS_MOMENTS = 1 << 0,   /** sum, sum_sq, m2, min and max */
+    STAZ_DS_GEOMETRIC = 1 << 1, /** geometric mean */
+    STAZ_DS_HARMONIC = 1 << 2,  /** harmonic mean */
+} staz_dataset_cache;
+
+/**
+ * @brief Handle wrapping a buffer and memoizing the statistics derived from it
+ * 
+ * @note The buffer is not copied nor owned. After modifying it, call
+ *       staz_dataset_invalidate() before the next query.
+ */
+typedef struct {
+    const double* nums; /** Wrapped buffer */
+    size_t len;         /** Length of the buffer */
+    unsigned cached;    /** Set of staz_dataset_cache flags */
+    double sum;         /** Pairwise sum */
+    double sum_sq;      /** Sum of squares */
+    double m2;          /** Sum of squared deviations from the mean */
+    double min;         /** Minimum value */
+    double max;         /** Maximum value */
+    double geometric;   /** Geometric mean */
+    double harmonic;    /** Harmonic mean */
+    double* sorted;     /** Sorted copy, NULL until first needed */
+} staz_dataset;
+
+/**
+ * @brief Creates a dataset handle over a buffer
+ * 
+ * @param nums Pointer to the array of double values
+ * @param len Length of the array
+ * 
+ * @return staz_dataset Handle with an empty cache; nothing is computed yet
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if nums is NULL or len is 0
+ *       - 0 if operation succeeds
+ */
+staz_dataset
+staz_dataset_create(const double* nums, size_t len) {
+    staz_dataset ds;
+    memset(&ds, 0, sizeof(ds));
+
+    if (!nums || len == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return ds;
+    }
+
+    errno = 0;
+
+    ds.nums = nums;
+    ds.len = len;
+    return ds;
+}
+
+/**
+ * @brief Drops every cached statistic, to be called after the buffer changes
+ * 
+ * @param ds Pointer to the dataset
+ */
+void
+staz_dataset_invalidate(staz_dataset* ds) {
+    if (!ds) return;
+
+    free(ds->sorted);
+    ds->sorted = NULL;
+    ds->cached = 0;
+}
+
+/**
+ * @brief Releases the memory held by a dataset (the wrapped buffer is untouched)
+ * 
+ * @param ds Pointer to the dataset
+ */
+void
+staz_dataset_destroy(staz_dataset* ds) {
+    if (!ds) return;
+
+    staz_dataset_invalidate(ds);
+    ds->nums = NULL;
+    ds->len = 0;
+}
+
+/**
+ * @brief Computes sum, sum of squares, min and max in one pass and the
+ *        centered second moment in another, unless already cached
+ * 
+ * @return int 0 if ds is not a valid dataset (errno is set), 1 otherwise
+ */
+static int
+_staz_dataset_moments(staz_dataset* ds) {
+    if (!ds || !ds->nums || ds->len == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return 0;
+    }
+
+    errno = 0;
+
+    if (ds->cached & STAZ_DS_MOMENTS) return 1;
+
+    const double* nums = ds->nums;
+    const size_t len = ds->len;
+
+    ds->sum = staz_sum(nums, len);
+    ds->sum_sq = staz_quadratic_sum(nums, len);
+    ds->min = staz_min_value(nums, len);
+    ds->max = staz_max_value(nums, len);
+
+    const double mean = ds->sum / len;
+    double m0 = 0.0, m1 = 0.0;
+    size_t i = 0;
+
+    for (; i + 2 <= len; i += 2) {
+        m0 += (nums[i] - mean) * (nums[i] - mean);
+        m1 += (nums[i + 1] - mean) * (nums[i + 1] - mean);
+    }
+    for (; i < len; i++) {
+        m0 += (nums[i] - mean) * (nums[i] - mean);
+    }
+
+    ds->m2 = m0 + m1;
+    ds->cached |= STAZ_DS_MOMENTS;
+    return 1;
+}
+
+/**
+ * @brief Returns the sorted copy of a dataset, building it on first demand
+ * 
+ * @return const double* The sorted copy, NULL on error (errno is set)
+ */
+static const double*
+_staz_dataset_sorted(staz_dataset* ds) {
+    if (!ds || !ds->nums || ds->len == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NULL;
+    }
+
+    errno = 0;
+
+    if (ds->sorted) return ds->sorted;
+
+    ds->sorted = copy_array(ds->nums, ds->len);
+    if (!ds->sorted) return NULL;
+
+    _staz_sort(ds->sorted, ds->len);
+    return ds->sorted;
+}
+
+/**
+ * @brief Calculates different types of means of a dataset
+ * 
+ * @param ds Pointer to the dataset
+ * @param mtype The type of mean to calculate
+ * 
+ * @return double The calculated mean value, NAN on error
+ * 
+ * @note Same results and errno settings as staz_mean(); after the first
+ *       query every mean type is answered in O(1).
+ */
+double
+staz_dataset_mean(staz_dataset* ds, staz_mean_type mtype) {
+    switch (mtype) {
+    case ARITHMETICAL:
+        if (!_staz_dataset_moments(ds)) return NAN;
+        return ds->sum / ds->len;
+
+    case QUADRATICAL:
+        if (!_staz_dataset_moments(ds)) return NAN;
+        return sqrt(ds->sum_sq / ds->len);
+
+    case EXTREMES:
+        if (!_staz_dataset_moments(ds)) return NAN;
+        if (ds->len < 2) {
+            errno = INVALID_PARAMETERS_ERROR;
+            return NAN;
+        }
+        return (ds->min + ds->max) / 2.0;
+
+    case GEOMETRICAL:
+    case HARMONICAL: {
+        if (!ds || !ds->nums || ds->len == 0) {
+            errno = INVALID_PARAMETERS_ERROR;
+            return NAN;
+        }
+
+        const staz_dataset_cache flag = (mtype == GEOMETRICAL) ? STAZ_DS_GEOMETRIC : STAZ_DS_HARMONIC;
+        double* slot = (mtype == GEOMETRICAL) ? &ds->geometric : &ds->harmonic;
+
+        if (ds->cached & flag) {
+            errno = 0;
+            return *slot;
+        }
+
+        // Both kinds only read the buffer, despite the non-const prototype
+        const double value = staz_mean(mtype, (double *)ds->nums, ds->len);
+        if (isnan(value)) return NAN;
+
+        *slot = value;
+        ds->cached |= flag;
+        return value;
+    }
+
+    case TRIMEAN: {
+        const double* sorted = _staz_dataset_sorted(ds);
+        if (!sorted) return NAN;
+
+        const double q1 = _staz_quantile_sorted(sorted, ds->len, 4, 1);
+        const double q2 = _staz_quantile_sorted(sorted, ds->len, 4, 2);
+        const double q3 = _staz_quantile_sorted(sorted, ds->len, 4, 3);
+
+        return (q1 + 2 * q2 + q3) / 4.0;
+    }
+
+    case MIDHINGE: {
+        const double* sorted = _staz_dataset_sorted(ds);
+        if (!sorted) return NAN;
+
+        const double q1 = _staz_quantile_sorted(sorted, ds->len, 4, 1);
+        const double q3 = _staz_quantile_sorted(sorted, ds->len, 4, 3);
+
+        return (q1 + q3) / 2;
+    }
+
+    default:
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+}
+
+/**
+ * @brief Calculates the population variance of a dataset
+ * 
+ * @param ds Pointer to the dataset
+ * 
+ * @return double The variance, NAN on error
+ * 
+ * @note Unlike staz_variance(), the wrapped buffer is not modified.
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if ds is not a valid dataset
+ *       - 0 if operation succeeds
+ */
+double
+staz_dataset_variance(staz_dataset* ds) {
+    if (!_staz_dataset_moments(ds)) return NAN;
+
+    return ds->m2 / ds->len;
+}
+
+/**
+ * @brief Calculates the median of a dataset
+ * 
+ * @param ds Pointer to the dataset
+ * 
+ * @return double The median, NAN on error
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if ds is not a valid dataset
+ *       - MEMORY_ALLOCATION_ERROR if the sorted copy cannot be allocated
+ *       - 0 if operation succeeds
+ */
+double
+staz_dataset_median(staz_dataset* ds) {
+    const double* sorted = _staz_dataset_sorted(ds);
+    if (!sorted) return NAN;
+
+    return _staz_median_sorted(sorted, ds->len);
+}
+
+/**
+ * @brief Calculates a quantile of a dataset
+ * 
+ * @param ds Pointer to the dataset
+ * @param mtype Quantile division (e.g., 1000, 20, 30, 4)
+ * @param posx Position of the quantile (range: 1 to mtype-1)
+ * 
+ * @return double The quantile, NAN on error
+ * 
+ * @note Same interpolation and errno settings as staz_quantile()
+ */
+double
+staz_dataset_quantile(staz_dataset* ds, int mtype, size_t posx) {
+    if (posx < 1) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    /* Measure type must be between 1 and mtype-1 */
+    if (posx > (size_t)mtype - 1) {
+        errno = RANGEOUT_ERROR;
+        return NAN;
+    }
+
+    const double* sorted = _staz_dataset_sorted(ds);
+    if (!sorted) return NAN;
+
+    return _staz_quantile_sorted(sorted, ds->len, mtype, posx);
+}
+
+/**
+ * @brief Calculates different types of range of a dataset
+ * 
+ * @param ds Pointer to the dataset
+ * @param rtype Type of range calculation
+ * 
+ * @return double The range, NAN on error
+ * 
+ * @note Same results and errno settings as staz_range()
+ */
+double
+staz_dataset_range(staz_dataset* ds, staz_range_type rtype) {
+    switch (rtype) {
+    case R_STANDARD:
+        if (!_staz_dataset_moments(ds)) return NAN;
+        if (isnan(ds->max) || isnan(ds->min)) {
+            errno = NAN_ERROR;
+            return NAN;
+        }
+        return ds->max - ds->min;
+
+    case R_INTERQUARTILE:
+        return staz_dataset_quantile(ds, 4, 3) - staz_dataset_quantile(ds, 4, 1);
+
+    case R_PERCENTILE:
+        return staz_dataset_quantile(ds, 100, 90) - staz_dataset_quantile(ds, 100, 10);
+
+    default:
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+}
+
+/**
+ * @brief Calculates the boxplot information of a dataset
+ * 
+ * @param ds Pointer to the dataset
+ * 
+ * @return staz_boxplot_info Same fields as staz_boxplot(), all NAN on error
+ */
+staz_boxplot_info
+staz_dataset_boxplot(staz_dataset* ds) {
+    const double* sorted = _staz_dataset_sorted(ds);
+    if (!sorted || !_staz_dataset_moments(ds)) {
+        return (staz_boxplot_info) {NAN, NAN, NAN, NAN, NAN, NAN, NAN};
+    }
+
+    const double q1 = _staz_quantile_sorted(sorted, ds->len, 4, 1);
+    const double q3 = _staz_quantile_sorted(sorted, ds->len, 4, 3);
+    const double iqr = q3 - q1;
+
+    return (staz_boxplot_info) {
+        q3,
+        _staz_median_sorted(sorted, ds->len),
+        q1,
+        q3 + 1.5 * iqr,
+        q1 - 1.5 * iqr,
+        ds->max,
+        ds->min
+    };
+}
+
+/* --- ORDER-STATISTIC TREE --- */
+
+#define STAZ_OSTREE_NIL UINT32_MAX
+
+/**
+ * @brief Node of a staz_ostree, stored in a contiguous pool
+ */
+typedef struct {
+    double key;        /** Value */
+    double sum;        /** Sum of (value - shift) over the subtree */
+    double sum_sq;     /** Sum of (value - shift)^2 over the subtree */
+    size_t size;       /** Number of values in the subtree, repetitions included */
+    uint32_t count;    /** Repetitions of key */
+    uint32_t priority; /** Heap priority of the treap */
+    uint32_t left;     /** Index of the left child or STAZ_OSTREE_NIL */
+    uint32_t right;    /** Index of the right child or STAZ_OSTREE_NIL */
+} staz_ostree_node;
+
+/**
+ * @brief Dynamic multiset of values answering order statistics in O(log n)
+ * 
+ * A treap whose nodes carry subtree counts and sums. Nodes live in one
+ * array and link by 32-bit index, so they stay packed however the tree
+ * is reshaped and freed nodes are reused.
+ */
+typedef struct {
+    staz_ostree_node* nodes; /** Node pool */
+    uint32_t capacity;       /** Allocated nodes */
+    uint32_t used;           /** Nodes ever handed out */
+    uint32_t free_list;      /** Released nodes, chained through left */
+    uint32_t root;           /** Root node or STAZ_OSTREE_NIL */
+    uint32_t seed;           /** State of the priority generator */
+    int anchored;            /** 1 if shift is a value currently in the tree */
+    double shift;            /** Finite value the sums are taken relative to */
+} staz_ostree;
+
+/**
+ * @brief Creates an empty order-statistic tree
+ * 
+ * @param capacity Number of distinct values to reserve room for (may be 0)
+ * 
+ * @return staz_ostree The tree
+ * 
+ * @note Sets errno to:
+ *       - MEMORY_ALLOCATION_ERROR if memory allocation fails
+ *       - 0 if operation succeeds
+ */
+staz_ostree
+staz_ostree_create(size_t capacity) {
+    staz_ostree t;
+    memset(&t, 0, sizeof(t));
+
+    t.root = STAZ_OSTREE_NIL;
+    t.free_list = STAZ_OSTREE_NIL;
+    t.seed = 2463534242u;
+
+    errno = 0;
+
+    if (capacity > 0) {
+        if (capacity >= STAZ_OSTREE_NIL) capacity = STAZ_OSTREE_NIL - 1;
+
+        t.nodes = (staz_ostree_node *)malloc(capacity * sizeof(staz_ostree_node));
+        if (!t.nodes) {
+            errno = MEMORY_ALLOCATION_ERROR;
+            return t;
+        }
+
+        t.capacity = (uint32_t)capacity;
+    }
+
+    return t;
+}
+
+/**
+ * @brief Releases the memory held by an order-statistic tree
+ */
+void
+staz_ostree_destroy(staz_ostree* t) {
+    if (!t) return;
+
+    free(t->nodes);
+    memset(t, 0, sizeof(*t));
+    t->root = STAZ_OSTREE_NIL;
+    t->free_list = STAZ_OSTREE_NIL;
+}
+
+/**
+ * @brief Number of values stored in the tree, repetitions included
+ */
+size_t
+staz_ostree_size(const staz_ostree* t) {
+    return (t && t->root != STAZ_OSTREE_NIL) ? t->nodes[t->root].size : 0;
+}
+
+/**
+ * @brief Recomputes the aggregates of node i from its children
+ */
+static inline void
+_staz_ostree_pull(staz_ostree* t, uint32_t i) {
+    staz_ostree_node* n = &t->nodes[i];
+    const double d = n->key - t->shift;
+
+    n->size = n->count;
+    n->sum = d * n->count;
+    n->sum_sq = d * d * n->count;
+
+    if (n->left != STAZ_OSTREE_NIL) {
+        const staz_ostree_node* l = &t->nodes[n->left];
+        n->size += l->size;
+        n->sum += l->sum;
+        n->sum_sq += l->sum_sq;
+    }
+
+    if (n->right != STAZ_OSTREE_NIL) {
+        const staz_ostree_node* r = &t->nodes[n->right];
+        n->size += r->size;
+        n->sum += r->sum;
+        n->sum_sq += r->sum_sq;
+    }
+}
+
+/**
+ * @brief Recomputes the aggregates of the subtree at i, children first
+ */
+static void
+_staz_ostree_pull_all(staz_ostree* t, uint32_t i) {
+    if (i == STAZ_OSTREE_NIL) return;
+
+    _staz_ostree_pull_all(t, t->nodes[i].left);
+    _staz_ostree_pull_all(t, t->nodes[i].right);
+    _staz_ostree_pull(t, i);
+}
+
+static uint32_t
+_staz_ostree_rotate_right(staz_ostree* t, uint32_t i) {
+    const uint32_t l = t->nodes[i].left;
+
+    t->nodes[i].left = t->nodes[l].right;
+    t->nodes[l].right = i;
+
+    _staz_ostree_pull(t, i);
+    _staz_ostree_pull(t, l);
+    return l;
+}
+
+static uint32_t
+_staz_ostree_rotate_left(staz_ostree* t, uint32_t i) {
+    const uint32_t r = t->nodes[i].right;
+
+    t->nodes[i].right = t->nodes[r].left;
+    t->nodes[r].left = i;
+
+    _staz_ostree_pull(t, i);
+    _staz_ostree_pull(t, r);
+    return r;
+}
+
+/**
+ * @brief Takes a node from the free list or the pool; capacity must be available
+ */
+static uint32_t
+_staz_ostree_new_node(staz_ostree* t, double x) {
+    uint32_t i;
+
+    if (t->free_list != STAZ_OSTREE_NIL) {
+        i = t->free_list;
+        t->free_list = t->nodes[i].left;
+    } else {
+        i = t->used++;
+    }
+
+    // xorshift32
+    t->seed ^= t->seed << 13;
+    t->seed ^= t->seed >> 17;
+    t->seed ^= t->seed << 5;
+
+    staz_ostree_node* n = &t->nodes[i];
+    n->key = x;
+    n->count = 1;
+    n->priority = t->seed;
+    n->left = STAZ_OSTREE_NIL;
+    n->right = STAZ_OSTREE_NIL;
+
+    _staz_ostree_pull(t, i);
+    return i;
+}
+
+static uint32_t
+_staz_ostree_insert_at(staz_ostree* t, uint32_t i, double x) {
+    if (i == STAZ_OSTREE_NIL) return _staz_ostree_new_node(t, x);
+
+    const double key = t->nodes[i].key;
+
+    if (x < key) {
+        const uint32_t l = _staz_ostree_insert_at(t, t->nodes[i].left, x);
+        t->nodes[i].left = l;
+        if (t->nodes[l].priority > t->nodes[i].priority) return _staz_ostree_rotate_right(t, i);
+    } else if (x > key) {
+        const uint32_t r = _staz_ostree_insert_at(t, t->nodes[i].right, x);
+        t->nodes[i].right = r;
+        if (t->nodes[r].priority > t->nodes[i].priority) return _staz_ostree_rotate_left(t, i);
+    } else {
+        t->nodes[i].count++;
+    }
+
+    _staz_ostree_pull(t, i);
+    return i;
+}
+
+/**
+ * @brief Inserts a value into the tree in O(log n)
+ * 
+ * @param t Pointer to the tree
+ * @param x Value to insert
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if t is NULL
+ *       - NAN_ERROR if x is NAN
+ *       - MEMORY_ALLOCATION_ERROR if the node pool cannot grow
+ *       - 0 if operation succeeds
+ */
+void
+staz_ostree_insert(staz_ostree* t, double x) {
+    if (!t) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return;
+    }
+
+    if (isnan(x)) {
+        errno = NAN_ERROR;
+        return;
+    }
+
+    errno = 0;
+
+    if (t->free_list == STAZ_OSTREE_NIL && t->used == t->capacity) {
+        if (t->capacity == STAZ_OSTREE_NIL - 1) {
+            errno = MEMORY_ALLOCATION_ERROR;
+            return;
+        }
+
+        uint64_t grown = t->capacity ? (uint64_t)t->capacity * 2 : 64;
+        if (grown >= STAZ_OSTREE_NIL) grown = STAZ_OSTREE_NIL - 1;
+
+        staz_ostree_node* nodes = (staz_ostree_node *)realloc(t->nodes, (size_t)grown * sizeof(staz_ostree_node));
+        if (!nodes) {
+            errno = MEMORY_ALLOCATION_ERROR;
+            return;
+        }
+
+        t->nodes = nodes;
+        t->capacity = (uint32_t)grown;
+    }
+
+    // The first finite value becomes the shift (an infinite one would make every sum NAN)
+    if (!t->anchored && isfinite(x)) {
+        t->shift = x;
+        t->anchored = 1;
+        _staz_ostree_pull_all(t, t->root);
+    }
+
+    t->root = _staz_ostree_insert_at(t, t->root, x);
+}
+
+/**
+ * @brief Counts the values strictly less than x in O(log n)
+ * 
+ * @note Sets errno to INVALID_PARAMETERS_ERROR if t is NULL, 0 otherwise
+ */
+size_t
+staz_ostree_rank(const staz_ostree* t, double x) {
+    if (!t) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return 0;
+    }
+
+    errno = 0;
+
+    size_t rank = 0;
+    uint32_t i = t->root;
+
+    while (i != STAZ_OSTREE_NIL) {
+        const staz_ostree_node* n = &t->nodes[i];
+
+        if (x <= n->key) {
+            i = n->left;
+        } else {
+            rank += n->count;
+            if (n->left != STAZ_OSTREE_NIL) rank += t->nodes[n->left].size;
+            i = n->right;
+        }
+    }
+
+    return rank;
+}
+
+/**
+ * @brief Finds the k-th smallest value (zero-based) in O(log n)
+ * 
+ * @return double The value, NAN on error
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if t is NULL
+ *       - RANGEOUT_ERROR if k is not less than the size of the tree
+ *       - 0 if operation succeeds
+ */
+double
+staz_ostree_select(const staz_ostree* t, size_t k) {
+    if (!t) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    if (k >= staz_ostree_size(t)) {
+        errno = RANGEOUT_ERROR;
+        return NAN;
+    }
+
+    errno = 0;
+
+    uint32_t i = t->root;
+
+    for (;;) {
+        const staz_ostree_node* n = &t->nodes[i];
+        const size_t left = (n->left != STAZ_OSTREE_NIL) ? t->nodes[n->left].size : 0;
+
+        if (k < left) {
+            i = n->left;
+        } else if (k < left + n->count) {
+            return n->key;
+        } else {
+            k -= left + n->count;
+            i = n->right;
+        }
+    }
+}
+
+/**
+ * @brief Unlinks node i, rotating it down to a leaf first
+ * 
+ * @return uint32_t New root of the subtree
+ */
+static uint32_t
+_staz_ostree_remove_node(staz_ostree* t, uint32_t i) {
+    const uint32_t l = t->nodes[i].left;
+    const uint32_t r = t->nodes[i].right;
+
+    if (l == STAZ_OSTREE_NIL || r == STAZ_OSTREE_NIL) {
+        t->nodes[i].left = t->free_list;
+        t->free_list = i;
+        return (l == STAZ_OSTREE_NIL) ? r : l;
+    }
+
+    uint32_t top;
+
+    if (t->nodes[l].priority > t->nodes[r].priority) {
+        top = _staz_ostree_rotate_right(t, i);
+        t->nodes[top].right = _staz_ostree_remove_node(t, i);
+    } else {
+        top = _staz_ostree_rotate_left(t, i);
+        t->nodes[top].left = _staz_ostree_remove_node(t, i);
+    }
+
+    _staz_ostree_pull(t, top);
+    return top;
+}
+
+static uint32_t
+_staz_ostree_erase_at(staz_ostree* t, uint32_t i, double x, int* found) {
+    if (i == STAZ_OSTREE_NIL) return i;
+
+    const double key = t->nodes[i].key;
+
+    if (x < key) {
+        t->nodes[i].left = _staz_ostree_erase_at(t, t->nodes[i].left, x, found);
+    } else if (x > key) {
+        t->nodes[i].right = _staz_ostree_erase_at(t, t->nodes[i].right, x, found);
+    } else {
+        *found = 1;
+        if (t->nodes[i].count == 1) {
+            *found = 2;
+            return _staz_ostree_remove_node(t, i);
+        }
+        t->nodes[i].count--;
+    }
+
+    _staz_ostree_pull(t, i);
+    return i;
+}
+
+/**
+ * @brief Removes one occurrence of a value from the tree in O(log n)
+ * 
+ * @param t Pointer to the tree
+ * @param x Value to remove
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if t is NULL or x is not in the tree
+ *       - NAN_ERROR if x is NAN (the tree never holds one)
+ *       - 0 if operation succeeds
+ */
+void
+staz_ostree_erase(staz_ostree* t, double x) {
+    if (!t) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return;
+    }
+
+    if (isnan(x)) {
+        errno = NAN_ERROR;
+        return;
+    }
+
+    int found = 0;
+    t->root = _staz_ostree_erase_at(t, t->root, x, &found);
+
+    // The shift left the tree: move it to the middle finite value, if any
+    if (found == 2 && t->anchored && x == t->shift) {
+        const size_t lo = staz_ostree_rank(t, -DBL_MAX);
+        const size_t hi = staz_ostree_rank(t, INFINITY);
+
+        t->anchored = (lo < hi);
+        if (t->anchored) {
+            t->shift = staz_ostree_select(t, lo + (hi - lo) / 2);
+            _staz_ostree_pull_all(t, t->root);
+        }
+    }
+
+    errno = found ? 0 : INVALID_PARAMETERS_ERROR;
+}
+
+/**
+ * @brief Calculates a quantile of the values in the tree in O(log n)
+ * 
+ * @param t Pointer to the tree
+ * @param mtype Quantile division (e.g., 1000, 20, 30, 4)
+ * @param posx Position of the quantile (range: 1 to mtype-1)
+ * 
+ * @return double The quantile, NAN on error
+ * 
+ * @note Same interpolation and errno settings as staz_quantile()
+ */
+double
+staz_ostree_quantile(const staz_ostree* t, int mtype, size_t posx) {
+    const size_t len = staz_ostree_size(t);
+
+    if (len == 0 || posx < 1) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    /* Measure type must be between 1 and mtype-1 */
+    if (posx > (size_t)mtype - 1) {
+        errno = RANGEOUT_ERROR;
+        return NAN;
+    }
+
+    const double index = posx * (len + 1) / (double)mtype;
+    const size_t lower = (size_t)index;
+
+    if (lower >= len) return staz_ostree_select(t, len - 1);
+    if (lower == 0) return staz_ostree_select(t, 0);
+
+    const double lo = staz_ostree_select(t, lower - 1);
+    return lo + (index - lower) * (staz_ostree_select(t, lower) - lo);
+}
+
+/**
+ * @brief Calculates the median of the values in the tree in O(log n)
+ * 
+ * @note Sets errno to INVALID_PARAMETERS_ERROR if the tree is NULL or empty
+ */
+double
+staz_ostree_median(const staz_ostree* t) {
+    const size_t len = staz_ostree_size(t);
+
+    if (len == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    if (len % 2 != 0) return staz_ostree_select(t, len / 2);
+
+    return (staz_ostree_select(t, len / 2 - 1) + staz_ostree_select(t, len / 2)) / 2.0;
+}
+
+/**
+ * @brief Calculates different types of means of the values in the tree
+ * 
+ * @param t Pointer to the tree
+ * @param mtype The type of mean to calculate
+ * 
+ * @return double The mean, NAN on error
+ * 
+ * @note ARITHMETICAL and QUADRATICAL are O(1), EXTREMES, TRIMEAN and
+ *       MIDHINGE are O(log n). GEOMETRICAL and HARMONICAL are not kept up
+ *       to date by the tree and set INVALID_PARAMETERS_ERROR.
+ */
+double
+staz_ostree_mean(const staz_ostree* t, staz_mean_type mtype) {
+    const size_t len = staz_ostree_size(t);
+
+    if (len == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    errno = 0;
+
+    const staz_ostree_node* root = &t->nodes[t->root];
+
+    switch (mtype) {
+    case ARITHMETICAL:
+        return t->shift + root->sum / len;
+
+    case QUADRATICAL: {
+        // sum of x^2 = sum of d^2 + 2 * shift * sum of d + len * shift^2, with d = x - shift
+        const double sum_sq = root->sum_sq + 2 * t->shift * root->sum + len * t->shift * t->shift;
+        return sqrt(sum_sq / len);
+    }
+
+    case EXTREMES:
+        if (len < 2) {
+            errno = INVALID_PARAMETERS_ERROR;
+            return NAN;
+        }
+        return (staz_ostree_select(t, 0) + staz_ostree_select(t, len - 1)) / 2.0;
+
+    case TRIMEAN: {
+        const double q1 = staz_ostree_quantile(t, 4, 1);
+        const double q2 = staz_ostree_quantile(t, 4, 2);
+        const double q3 = staz_ostree_quantile(t, 4, 3);
+
+        return (q1 + 2 * q2 + q3) / 4.0;
+    }
+
+    case MIDHINGE:
+        return (staz_ostree_quantile(t, 4, 1) + staz_ostree_quantile(t, 4, 3)) / 2;
+
+    default:
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+}
+
+/**
+ * @brief Calculates the population variance of the values in the tree in O(1)
+ * 
+ * @note Sums are kept relative to a finite value of the tree, which limits
+ *       cancellation when values sit far from zero. When that value is
+ *       erased, the middle finite value takes over and the sums are
+ *       rebuilt in O(n); in a sliding window this happens about once per
+ *       half window, so the amortized cost stays O(1).
+ *       Sets errno to INVALID_PARAMETERS_ERROR if the tree is NULL or empty
+ */
+double
+staz_ostree_variance(const staz_ostree* t) {
+    const size_t len = staz_ostree_size(t);
+
+    if (len == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    errno = 0;
+
+    const staz_ostree_node* root = &t->nodes[t->root];
+    const double mean_d = root->sum / len;
+    const double var = root->sum_sq / len - mean_d * mean_d;
+
+    return (var < 0) ? 0.0 : var;
+}
+
+/* --- WAVELET MATRIX --- */
+
+/**
+ * @brief Counts the bits set in a 64-bit word
+ */
+static inline unsigned
+_staz_popcount64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (unsigned)((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/**
+ * @brief Finds the number of elements of a sorted array less than x
+ */
+static inline size_t
+_staz_lower_bound(const double* sorted, size_t len, double x) {
+    size_t lo = 0;
+
+    while (len > 0) {
+        const size_t half = len / 2;
+
+        if (sorted[lo + half] < x) {
+            lo += half + 1;
+            len -= half + 1;
+        } else {
+            len = half;
+        }
+    }
+
+    return lo;
+}
+
+/** Words of a bitvector covered by one rank directory entry */
+#define STAZ_WAVELET_BLOCK_WORDS 8
+
+/**
+ * @brief Wavelet matrix over the ranks of the values of an array
+ * 
+ * Every value is replaced by its rank among the distinct values, and each
+ * bit of the ranks, most significant first, gets its own bitvector with a
+ * rank directory. Queries over any slice then take O(log sigma), where
+ * sigma is the number of distinct values.
+ */
+typedef struct {
+    size_t len;      /** Length of the indexed array */
+    size_t sigma;    /** Number of distinct values */
+    unsigned levels; /** Bits per rank */
+    size_t words;    /** 64-bit words per bitvector */
+    size_t blocks;   /** Rank directory entries per bitvector */
+    double* values;  /** Sorted distinct values */
+    uint64_t* bits;  /** levels bitvectors of words words */
+    size_t* ranks;   /** levels directories of blocks entries: ones before each block */
+    size_t* zeros;   /** Number of zero bits of each level */
+} staz_wavelet;
+
+/**
+ * @brief Counts the ones among the first i bits of a level
+ */
+static inline size_t
+_staz_wavelet_rank1(const staz_wavelet* wm, unsigned level, size_t i) {
+    const uint64_t* bits = wm->bits + level * wm->words;
+    const size_t w = i / 64;
+    const size_t b = w / STAZ_WAVELET_BLOCK_WORDS;
+
+    size_t r = wm->ranks[level * wm->blocks + b];
+
+    for (size_t j = b * STAZ_WAVELET_BLOCK_WORDS; j < w; j++) {
+        r += _staz_popcount64(bits[j]);
+    }
+
+    if (i % 64) r += _staz_popcount64(bits[w] & ((1ULL << (i % 64)) - 1));
+
+    return r;
+}
+
+/**
+ * @brief Builds a wavelet matrix over an array
+ * 
+ * @param nums Pointer to the array of double values
+ * @param len Length of the array
+ * 
+ * @return staz_wavelet The index; every field is zero on error
+ * 
+ * @note Takes O(n log sigma) time and about n log sigma bits plus the
+ *       distinct values. The array is not referenced after the call.
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if nums is NULL or len is 0
+ *       - NAN_ERROR if the array holds a NAN
+ *       - MEMORY_ALLOCATION_ERROR if memory allocation fails
+ *       - 0 if operation succeeds
+ */
+staz_wavelet
+staz_wavelet_create(const double* nums, size_t len) {
+    staz_wavelet wm;
+    memset(&wm, 0, sizeof(wm));
+
+    if (!nums || len == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return wm;
+    }
+
+    double* values = copy_array(nums, len);
+    if (!values) return wm;
+
+    if (_staz_partition_nan(values, len) != len) {
+        free(values);
+        errno = NAN_ERROR;
+        return wm;
+    }
+
+    _staz_sort(values, len);
+
+    size_t sigma = 1;
+    for (size_t i = 1; i < len; i++) {
+        if (values[i] != values[sigma - 1]) values[sigma++] = values[i];
+    }
+
+    unsigned levels = 1;
+    while (levels < 64 && (sigma - 1) >> levels) levels++;
+
+    const size_t words = len / 64 + 1;
+    const size_t blocks = words / STAZ_WAVELET_BLOCK_WORDS + 1;
+
+    uint64_t* bits = (uint64_t *)calloc(levels * words, sizeof(uint64_t));
+    size_t* ranks = (size_t *)malloc((levels * blocks + levels) * sizeof(size_t));
+    size_t* codes = (size_t *)malloc(2 * len * sizeof(size_t));
+
+    if (!bits || !ranks || !codes) {
+        free(values);
+        free(bits);
+        free(ranks);
+        free(codes);
+        errno = MEMORY_ALLOCATION_ERROR;
+        return wm;
+    }
+
+    errno = 0;
+
+    size_t* cur = codes;
+    size_t* next = codes + len;
+
+    for (size_t i = 0; i < len; i++) {
+        cur[i] = _staz_lower_bound(values, sigma, nums[i]);
+    }
+
+    for (unsigned level = 0; level < levels; level++) {
+        const unsigned shift = levels - 1 - level;
+        uint64_t* lbits = bits + level * words;
+        size_t* lranks = ranks + level * blocks;
+        size_t nz = 0;
+
+        for (size_t i = 0; i < len; i++) {
+            if ((cur[i] >> shift) & 1) lbits[i / 64] |= 1ULL << (i % 64);
+            else nz++;
+        }
+
+        size_t ones = 0;
+        for (size_t w = 0; w < words; w++) {
+            if (w % STAZ_WAVELET_BLOCK_WORDS == 0) lranks[w / STAZ_WAVELET_BLOCK_WORDS] = ones;
+            ones += _staz_popcount64(lbits[w]);
+        }
+
+        // Stable partition: codes with a zero bit first, then the ones
+        size_t z = 0, o = nz;
+        for (size_t i = 0; i < len; i++) {
+            if ((cur[i] >> shift) & 1) next[o++] = cur[i];
+            else next[z++] = cur[i];
+        }
+
+        ranks[levels * blocks + level] = nz;
+
+        size_t* t = cur;
+        cur = next;
+        next = t;
+    }
+
+    free(codes);
+
+    // Shrink the distinct values to what is used
+    double* shrunk = (double *)realloc(values, sigma * sizeof(double));
+
+    wm.len = len;
+    wm.sigma = sigma;
+    wm.levels = levels;
+    wm.words = words;
+    wm.blocks = blocks;
+    wm.values = shrunk ? shrunk : values;
+    wm.bits = bits;
+    wm.ranks = ranks;
+    wm.zeros = ranks + levels * blocks;
+    return wm;
+}
+
+/**
+ * @brief Releases the memory held by a wavelet matrix
+ */
+void
+staz_wavelet_destroy(staz_wavelet* wm) {
+    if (!wm) return;
+
+    free(wm->values);
+    free(wm->bits);
+    free(wm->ranks);
+    memset(wm, 0, sizeof(*wm));
+}
+
+/**
+ * @brief Validates a wavelet matrix and a slice [start, end)
+ */
+static int
+_staz_wavelet_check(const staz_wavelet* wm, size_t start, size_t end) {
+    if (!wm || !wm->values || start >= end) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return 0;
+    }
+
+    if (end > wm->len) {
+        errno = RANGEOUT_ERROR;
+        return 0;
+    }
+
+    errno = 0;
+    return 1;
+}
+
+/**
+ * @brief Finds the k-th smallest value (zero-based) of nums[start..end)
+ * 
+ * @param wm Pointer to the wavelet matrix
+ * @param start First index of the slice
+ * @param end One past the last index of the slice
+ * @param k Rank inside the slice
+ * 
+ * @return double The value, NAN on error
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if wm is invalid or the slice is empty
+ *       - RANGEOUT_ERROR if end is past the array or k is not less than end - start
+ *       - 0 if operation succeeds
+ */
+double
+staz_wavelet_select(const staz_wavelet* wm, size_t start, size_t end, size_t k) {
+    if (!_staz_wavelet_check(wm, start, end)) return NAN;
+
+    if (k >= end - start) {
+        errno = RANGEOUT_ERROR;
+        return NAN;
+    }
+
+    size_t code = 0;
+
+    for (unsigned level = 0; level < wm->levels; level++) {
+        const size_t ones_start = _staz_wavelet_rank1(wm, level, start);
+        const size_t ones_end = _staz_wavelet_rank1(wm, level, end);
+        const size_t zeros = (end - start) - (ones_end - ones_start);
+
+        code <<= 1;
+
+        if (k < zeros) {
+            start -= ones_start;
+            end -= ones_end;
+        } else {
+            k -= zeros;
+            code |= 1;
+            start = wm->zeros[level] + ones_start;
+            end = wm->zeros[level] + ones_end;
+        }
+    }
+
+    return wm->values[code];
+}
+
+/**
+ * @brief Counts the values of nums[start..end) that are less than x
+ * 
+ * @return size_t The count, 0 on error
+ * 
+ * @note Sets errno like staz_wavelet_select()
+ */
+size_t
+staz_wavelet_count_below(const staz_wavelet* wm, size_t start, size_t end, double x) {
+    if (!_staz_wavelet_check(wm, start, end)) return 0;
+
+    const size_t code = _staz_lower_bound(wm->values, wm->sigma, x);
+    if (code >> wm->levels) return end - start;
+
+    size_t count = 0;
+
+    for (unsigned level = 0; level < wm->levels; level++) {
+        const size_t ones_start = _staz_wavelet_rank1(wm, level, start);
+        const size_t ones_end = _staz_wavelet_rank1(wm, level, end);
+
+        if ((code >> (wm->levels - 1 - level)) & 1) {
+            count += (end - start) - (ones_end - ones_start);
+            start = wm->zeros[level] + ones_start;
+            end = wm->zeros[level] + ones_end;
+        } else {
+            start -= ones_start;
+            end -= ones_end;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * @brief Counts the occurrences of x in nums[start..end)
+ * 
+ * @return size_t The count, 0 on error
+ * 
+ * @note Sets errno like staz_wavelet_select()
+ */
+size_t
+staz_wavelet_frequency(const staz_wavelet* wm, size_t start, size_t end, double x) {
+    if (!_staz_wavelet_check(wm, start, end)) return 0;
+
+    const size_t code = _staz_lower_bound(wm->values, wm->sigma, x);
+    if (code == wm->sigma || wm->values[code] != x) return 0;
+
+    for (unsigned level = 0; level < wm->levels && start < end; level++) {
+        const size_t ones_start = _staz_wavelet_rank1(wm, level, start);
+        const size_t ones_end = _staz_wavelet_rank1(wm, level, end);
+
+        if ((code >> (wm->levels - 1 - level)) & 1) {
+            start = wm->zeros[level] + ones_start;
+            end = wm->zeros[level] + ones_end;
+        } else {
+            start -= ones_start;
+            end -= ones_end;
+        }
+    }
+
+    return end - start;
+}
+
+/**
+ * @brief Calculates a quantile of nums[start..end)
+ * 
+ * @param wm Pointer to the wavelet matrix
+ * @param start First index of the slice
+ * @param end One past the last index of the slice
+ * @param mtype Quantile division (e.g., 1000, 20, 30, 4)
+ * @param posx Position of the quantile (range: 1 to mtype-1)
+ * 
+ * @return double The quantile, NAN on error
+ * 
+ * @note Same interpolation as staz_quantile() on the slice.
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if wm is invalid, the slice is empty or posx is 0
+ *       - RANGEOUT_ERROR if end is past the array or posx is invalid for mtype
+ *       - 0 if operation succeeds
+ */
+double
+staz_wavelet_quantile(const staz_wavelet* wm, size_t start, size_t end, int mtype, size_t posx) {
+    if (!_staz_wavelet_check(wm, start, end)) return NAN;
+
+    if (posx < 1) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    /* Measure type must be between 1 and mtype-1 */
+    if (posx > (size_t)mtype - 1) {
+        errno = RANGEOUT_ERROR;
+        return NAN;
+    }
+
+    const size_t len = end - start;
+    const double index = posx * (len + 1) / (double)mtype;
+    const size_t lower = (size_t)index;
+
+    if (lower >= len) return staz_wavelet_select(wm, start, end, len - 1);
+    if (lower == 0) return staz_wavelet_select(wm, start, end, 0);
+
+    const double lo = staz_wavelet_select(wm, start, end, lower - 1);
+    return lo + (index - lower) * (staz_wavelet_select(wm, start, end, lower) - lo);
+}
+
+/**
+ * @brief Calculates the median of nums[start..end)
+ * 
+ * @note Sets errno like staz_wavelet_select()
+ */
+double
+staz_wavelet_median(const staz_wavelet* wm, size_t start, size_t end) {
+    if (!_staz_wavelet_check(wm, start, end)) return NAN;
+
+    const size_t len = end - start;
+
+    if (len % 2 != 0) return staz_wavelet_select(wm, start, end, len / 2);
+
+    return (staz_wavelet_select(wm, start, end, len / 2 - 1) + staz_wavelet_select(wm, start, end, len / 2)) / 2.0;
+}
+
+/* --- RANGE INDEX --- */
+
+/**
+ * @brief Floor of the base-2 logarithm of x (x > 0)
+ */
+static inline unsigned
+_staz_log2_floor(size_t x) {
+    unsigned r = 0;
+    while (x >>= 1) r++;
+    return r;
+}
+
+/**
+ * @brief Precomputed aggregates answering sub-range statistics in O(1)
+ * 
+ * Holds prefix sums of (x - shift) and (x - shift)^2, where shift is the
+ * mean of the whole array, each as a sum and its accumulated rounding
+ * error, and sparse tables of minima and maxima. The errors of the
+ * subtraction x - shift and of the squares are kept too, so a slice's
+ * sums are known to about twice the working precision. That is what a
+ * short slice of trending data (timestamps) needs: its variance is tiny
+ * next to the prefix sums it is taken from. With zone maps enabled, the sparse tables are built over the
+ * per-zone extremes instead and the partial zones at the ends of a query
+ * are scanned, which trades O(zone) queries for far less memory.
+ */
+typedef struct {
+    const double* nums; /** Indexed array, referenced (not copied) in zone mode */
+    size_t len;         /** Length of the indexed array */
+    size_t zone;        /** Values per zone, 0 for a sparse table over every value */
+    size_t count;       /** Entries per sparse table level (len or number of zones) */
+    unsigned levels;    /** Levels of the sparse tables */
+    double shift;       /** Mean of the whole array */
+    double* sum_hi;     /** Prefix sums of x - shift, len + 1 entries */
+    double* sum_lo;     /** Rounding errors of sum_hi */
+    double* sq_hi;      /** Prefix sums of (x - shift)^2, len + 1 entries */
+    double* sq_lo;      /** Rounding errors of sq_hi */
+    double* min_table;  /** levels * count minima; level 0 is the zone map in zone mode */
+    double* max_table;  /** levels * count maxima; level 0 is the zone map in zone mode */
+} staz_range_index;
+
+/**
+ * @brief Builds a range index over an array
+ * 
+ * @param nums Pointer to the array of double values
+ * @param len Length of the array
+ * @param zone Values per zone map entry, or 0 for a full sparse table
+ * 
+ * @return staz_range_index The index; every field is zero on error
+ * 
+ * @note With zone == 0 the index takes about (4 + 2 log2 n) doubles per
+ *       value and does not reference nums afterwards. With zone > 0 it
+ *       takes about 4 doubles per value, and nums must outlive the index.
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if nums is NULL or len is 0
+ *       - MEMORY_ALLOCATION_ERROR if memory allocation fails
+ *       - 0 if operation succeeds
+ */
+staz_range_index
+staz_range_index_create(const double* nums, size_t len, size_t zone) {
+    staz_range_index idx;
+    memset(&idx, 0, sizeof(idx));
+
+    if (!nums || len == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return idx;
+    }
+
+    const size_t count = zone ? (len + zone - 1) / zone : len;
+    const unsigned levels = _staz_log2_floor(count) + 1;
+
+    double* prefix = (double *)malloc(4 * (len + 1) * sizeof(double));
+    double* tables = (double *)malloc(2 * levels * count * sizeof(double));
+
+    if (!prefix || !tables) {
+        free(prefix);
+        free(tables);
+        errno = MEMORY_ALLOCATION_ERROR;
+        return idx;
+    }
+
+    errno = 0;
+
+    idx.nums = zone ? nums : NULL;
+    idx.len = len;
+    idx.zone = zone;
+    idx.count = count;
+    idx.levels = levels;
+    idx.shift = staz_sum(nums, len) / len;
+    idx.sum_hi = prefix;
+    idx.sum_lo = prefix + (len + 1);
+    idx.sq_hi = prefix + 2 * (len + 1);
+    idx.sq_lo = prefix + 3 * (len + 1);
+    idx.min_table = tables;
+    idx.max_table = tables + levels * count;
+
+    // Running sums with every rounding error collected: x - shift = d + de
+    // exactly, and (d + de)^2 = d^2 + 2 d de up to a term below ulp^2
+    double s = 0.0, sc = 0.0, q = 0.0, qc = 0.0;
+
+    idx.sum_hi[0] = idx.sum_lo[0] = idx.sq_hi[0] = idx.sq_lo[0] = 0.0;
+
+    for (size_t i = 0; i < len; i++) {
+        double de, e;
+        const double d = _staz_two_sum(nums[i], -idx.shift, &de);
+
+        s = _staz_two_sum(s, d, &e);
+        sc += e + de;
+
+        _staz_dot2_step(&q, &qc, d, d);
+        qc += 2.0 * d * de;
+
+        idx.sum_hi[i + 1] = s;
+        idx.sum_lo[i + 1] = sc;
+        idx.sq_hi[i + 1] = q;
+        idx.sq_lo[i + 1] = qc;
+    }
+
+    // Level 0: the values themselves, or one extreme per zone
+    if (zone) {
+        for (size_t z = 0; z < count; z++) {
+            const size_t begin = z * zone;
+            const size_t n = (len - begin < zone) ? len - begin : zone;
+
+            idx.min_table[z] = staz_min_value(nums + begin, n);
+            idx.max_table[z] = staz_max_value(nums + begin, n);
+        }
+    } else {
+        memcpy(idx.min_table, nums, len * sizeof(double));
+        memcpy(idx.max_table, nums, len * sizeof(double));
+    }
+
+    for (unsigned k = 1; k < levels; k++) {
+        const size_t half = (size_t)1 << (k - 1);
+        const double* pmin = idx.min_table + (k - 1) * count;
+        const double* pmax = idx.max_table + (k - 1) * count;
+        double* cmin = idx.min_table + k * count;
+        double* cmax = idx.max_table + k * count;
+
+        for (size_t i = 0; i + 2 * half <= count; i++) {
+            cmin[i] = (pmin[i + half] < pmin[i]) ? pmin[i + half] : pmin[i];
+            cmax[i] = (pmax[i + half] > pmax[i]) ? pmax[i + half] : pmax[i];
+        }
+    }
+
+    return idx;
+}
+
+/**
+ * @brief Releases the memory held by a range index
+ */
+void
+staz_range_index_destroy(staz_range_index* idx) {
+    if (!idx) return;
+
+    free(idx->sum_hi);
+    free(idx->min_table);
+    memset(idx, 0, sizeof(*idx));
+}
+
+/**
+ * @brief Validates a range index and a range [start, end)
+ */
+static int
+_staz_range_index_check(const staz_range_index* idx, size_t start, size_t end) {
+    if (!idx || !idx->sum_hi || start >= end) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return 0;
+    }
+
+    if (end > idx->len) {
+        errno = RANGEOUT_ERROR;
+        return 0;
+    }
+
+    errno = 0;
+    return 1;
+}
+
+/**
+ * @brief Extreme of entries [start, end) of the sparse table level 0
+ * 
+ * @param table min_table or max_table
+ * @param want_max Non-zero for the maximum
+ */
+static inline double
+_staz_sparse_query(const staz_range_index* idx, const double* table, size_t start, size_t end, int want_max) {
+    const unsigned k = _staz_log2_floor(end - start);
+    const double a = table[k * idx->count + start];
+    const double b = table[k * idx->count + end - ((size_t)1 << k)];
+
+    return want_max ? ((b > a) ? b : a) : ((b < a) ? b : a);
+}
+
+/**
+ * @brief Extreme of [start, end), combining zone scans and the sparse table
+ */
+static double
+_staz_range_index_extreme(const staz_range_index* idx, size_t start, size_t end, int want_max) {
+    const double* table = want_max ? idx->max_table : idx->min_table;
+
+    if (!idx->zone) return _staz_sparse_query(idx, table, start, end, want_max);
+
+    const size_t first_full = (start + idx->zone - 1) / idx->zone;
+    const size_t last_full = end / idx->zone; // one past
+
+    if (first_full >= last_full) {
+        return want_max ? staz_max_value(idx->nums + start, end - start)
+                        : staz_min_value(idx->nums + start, end - start);
+    }
+
+    double r = _staz_sparse_query(idx, table, first_full, last_full, want_max);
+
+    const size_t head_end = first_full * idx->zone;
+    const size_t tail_start = last_full * idx->zone;
+
+    for (size_t i = start; i < head_end; i++) {
+        const double x = idx->nums[i];
+        r = want_max ? ((x > r) ? x : r) : ((x < r) ? x : r);
+    }
+    for (size_t i = tail_start; i < end; i++) {
+        const double x = idx->nums[i];
+        r = want_max ? ((x > r) ? x : r) : ((x < r) ? x : r);
+    }
+
+    return r;
+}
+
+/**
+ * @brief Difference of two prefix sums as an unevaluated pair hi + *lo
+ */
+static inline double
+_staz_prefix_diff(const double* hi, const double* lo, size_t start, size_t end, double* rest) {
+    double e;
+    const double d = _staz_two_sum(hi[end], -hi[start], &e);
+
+    *rest = e + (lo[end] - lo[start]);
+    return d;
+}
+
+/**
+ * @brief Calculates the sum of nums[start..end) in O(1)
+ * 
+ * @param idx Pointer to the range index
+ * @param start First index of the range
+ * @param end One past the last index of the range
+ * 
+ * @return double The sum, NAN on error
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if idx is invalid or the range is empty
+ *       - RANGEOUT_ERROR if end is past the array
+ *       - 0 if operation succeeds
+ */
+double
+staz_range_index_sum(const staz_range_index* idx, size_t start, size_t end) {
+    if (!_staz_range_index_check(idx, start, end)) return NAN;
+
+    const double d = (idx->sum_hi[end] - idx->sum_hi[start]) + (idx->sum_lo[end] - idx->sum_lo[start]);
+
+    return d + idx->shift * (end - start);
+}
+
+/**
+ * @brief Calculates the arithmetic mean of nums[start..end) in O(1)
+ * 
+ * @note Sets errno like staz_range_index_sum()
+ */
+double
+staz_range_index_mean(const staz_range_index* idx, size_t start, size_t end) {
+    if (!_staz_range_index_check(idx, start, end)) return NAN;
+
+    const double d = (idx->sum_hi[end] - idx->sum_hi[start]) + (idx->sum_lo[end] - idx->sum_lo[start]);
+
+    return idx->shift + d / (end - start);
+}
+
+/**
+ * @brief Calculates the population variance of nums[start..end) in O(1)
+ * 
+ * @note Sets errno like staz_range_index_sum()
+ */
+double
+staz_range_index_variance(const staz_range_index* idx, size_t start, size_t end) {
+    if (!_staz_range_index_check(idx, start, end)) return NAN;
+
+    const double n = (double)(end - start);
+    double sl, ql, e, f;
+    const double sh = _staz_prefix_diff(idx->sum_hi, idx->sum_lo, start, end, &sl);
+    const double qh = _staz_prefix_diff(idx->sq_hi, idx->sq_lo, start, end, &ql);
+
+    // n var = Q - c S - c (S - n c) for any c; with c the slice mean the
+    // large terms cancel exactly in Q - c S, so no digit is lost to them
+    const double c = (sh + sl) / n;
+
+    const double nc = _staz_two_prod(n, c, &e);
+    const double r = (sh - nc) + (sl - e);
+
+    const double cs = _staz_two_prod(c, sh, &e);
+    const double a = _staz_two_sum(qh, -cs, &f);
+    const double var = (a + ((f + ql) - (e + c * sl)) - c * r) / n;
+
+    return (var < 0) ? 0.0 : var;
+}
+
+/**
+ * @brief Finds the minimum of nums[start..end)
+ * 
+ * @note O(1) with a full sparse table, O(zone) with zone maps.
+ *       Sets errno like staz_range_index_sum()
+ */
+double
+staz_range_index_min(const staz_range_index* idx, size_t start, size_t end) {
+    if (!_staz_range_index_check(idx, start, end)) return NAN;
+
+    return _staz_range_index_extreme(idx, start, end, 0);
+}
+
+/**
+ * @brief Finds the maximum of nums[start..end)
+ * 
+ * @note O(1) with a full sparse table, O(zone) with zone maps.
+ *       Sets errno like staz_range_index_sum()
+ */
+double
+staz_range_index_max(const staz_range_index* idx, size_t start, size_t end) {
+    if (!_staz_range_index_check(idx, start, end)) return NAN;
+
+    return _staz_range_index_extreme(idx, start, end, 1);
+}
+
+/* --- STREAMING ACCUMULATOR --- */
+
+/** Values folded at a time by staz_online_update, small enough to stay in cache */
+#ifndef STAZ_ONLINE_BLOCK
+#define STAZ_ONLINE_BLOCK 4096
+#endif
+
+/**
+ * @brief Running count, mean, centered second moment and extremes of a stream
+ * 
+ * Chunks are reduced in cache-sized blocks (pairwise mean, then centered
+ * squares) and folded in with Chan's parallel update, so the result is as
+ * stable as a two-pass computation while reading each value once.
+ */
+typedef struct {
+    size_t n;    /** Number of values seen */
+    double mean; /** Arithmetic mean */
+    double m2;   /** Sum of squared deviations from the mean */
+    double min;  /** Minimum value */
+    double max;  /** Maximum value */
+} staz_online;
+
+/**
+ * @brief Creates an empty streaming accumulator
+ */
+staz_online
+staz_online_create(void) {
+    staz_online acc = {0, 0.0, 0.0, INFINITY, -INFINITY};
+    return acc;
+}
+
+/**
+ * @brief Folds the moments of another accumulator into acc (Chan et al.)
+ * 
+ * @param acc Pointer to the accumulator to update
+ * @param other Pointer to the accumulator to fold in
+ */
+void
+staz_online_merge(staz_online* acc, const staz_online* other) {
+    if (!acc || !other) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return;
+    }
+
+    errno = 0;
+
+    if (other->n == 0) return;
+    if (acc->n == 0) {
+        *acc = *other;
+        return;
+    }
+
+    const double na = (double)acc->n, nb = (double)other->n;
+    const double n = na + nb;
+    const double delta = other->mean - acc->mean;
+
+    acc->mean += delta * (nb / n);
+    acc->m2 += other->m2 + delta * delta * (na * nb / n);
+    acc->n += other->n;
+
+    if (other->min < acc->min) acc->min = other->min;
+    if (other->max > acc->max) acc->max = other->max;
+}
+
+/**
+ * @brief Adds a chunk of values to a streaming accumulator
+ * 
+ * @param acc Pointer to the accumulator
+ * @param nums Pointer to the chunk of double values
+ * @param len Length of the chunk
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if acc or nums is NULL
+ *       - 0 if operation succeeds
+ */
+void
+staz_online_update(staz_online* acc, const double* nums, size_t len) {
+    if (!acc || (!nums && len > 0)) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return;
+    }
+
+    for (size_t begin = 0; begin < len; begin += STAZ_ONLINE_BLOCK) {
+        const size_t n = (len - begin < STAZ_ONLINE_BLOCK) ? len - begin : STAZ_ONLINE_BLOCK;
+        const double* block = nums + begin;
+
+        staz_online b;
+        b.n = n;
+        b.mean = staz_sum(block, n) / n;
+        b.min = staz_min_value(block, n);
+        b.max = staz_max_value(block, n);
+
+        double m0 = 0.0, m1 = 0.0;
+        size_t i = 0;
+
+        for (; i + 2 <= n; i += 2) {
+            m0 += (block[i] - b.mean) * (block[i] - b.mean);
+            m1 += (block[i + 1] - b.mean) * (block[i + 1] - b.mean);
+        }
+        for (; i < n; i++) {
+            m0 += (block[i] - b.mean) * (block[i] - b.mean);
+        }
+
+        b.m2 = m0 + m1;
+        staz_online_merge(acc, &b);
+    }
+
+    errno = 0;
+}
+
+/**
+ * @brief Arithmetic mean of the values seen, NAN (INVALID_PARAMETERS_ERROR) if none
+ */
+double
+staz_online_mean(const staz_online* acc) {
+    if (!acc || acc->n == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    errno = 0;
+    return acc->mean;
+}
+
+/**
+ * @brief Population variance of the values seen, NAN (INVALID_PARAMETERS_ERROR) if none
+ */
+double
+staz_online_variance(const staz_online* acc) {
+    if (!acc || acc->n == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    errno = 0;
+    return acc->m2 / acc->n;
+}
+
+/* --- FILE COLUMNS --- */
+
+/**
+ * @brief Element types of raw little-endian binary columns
+ */
+typedef enum {
+    STAZ_COLUMN_F64, /** IEEE-754 binary64 */
+    STAZ_COLUMN_F32, /** IEEE-754 binary32 */
+} staz_column_type;
+
+/**
+ * @brief Read-only memory mapping of a raw binary column file
+ */
+typedef struct {
+    const unsigned char* data; /** Mapped file contents */
+    size_t bytes;              /** Size of the mapping */
+    size_t len;                /** Number of values */
+    staz_column_type type;     /** Element type */
+} staz_column;
+
+/** Values per chunk used by staz_column_reduce when none is given */
+#ifndef STAZ_COLUMN_CHUNK
+#define STAZ_COLUMN_CHUNK (1u << 20)
+#endif
+
+static inline int
+_staz_is_little_endian(void) {
+    const uint16_t probe = 1;
+    unsigned char first;
+    memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+static inline size_t
+_staz_column_width(staz_column_type type) {
+    return (type == STAZ_COLUMN_F32) ? sizeof(float) : sizeof(double);
+}
+
+/**
+ * @brief Maps a raw little-endian column file into memory
+ * 
+ * @param path Path of the file
+ * @param type Element type of the file
+ * 
+ * @return staz_column The mapping; every field is zero on error
+ * 
+ * @note The mapping is advised for sequential access (and transparent
+ *       huge pages where supported). A trailing partial element is ignored.
+ *       Only available on POSIX systems.
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if path is NULL, type is unknown or the file is empty
+ *       - IO_ERROR if the file cannot be opened or mapped, or mmap is unavailable
+ *       - 0 if operation succeeds
+ */
+staz_column
+staz_column_map(const char* path, staz_column_type type) {
+    staz_column col;
+    memset(&col, 0, sizeof(col));
+
+    if (!path || (type != STAZ_COLUMN_F64 && type != STAZ_COLUMN_F32)) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return col;
+    }
+
+#if STAZ_HAVE_MMAP
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        errno = IO_ERROR;
+        return col;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        errno = IO_ERROR;
+        return col;
+    }
+
+    const size_t bytes = (size_t)st.st_size;
+    if (bytes < _staz_column_width(type)) {
+        close(fd);
+        errno = INVALID_PARAMETERS_ERROR;
+        return col;
+    }
+
+    void* data = mmap(NULL, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        errno = IO_ERROR;
+        return col;
+    }
+
+    STAZ_MADVISE(data, bytes, SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    STAZ_MADVISE(data, bytes, HUGEPAGE);
+#endif
+
+    errno = 0;
+
+    col.data = (const unsigned char *)data;
+    col.bytes = bytes;
+    col.len = bytes / _staz_column_width(type);
+    col.type = type;
+#else
+    errno = IO_ERROR;
+#endif
+
+    return col;
+}
+
+/**
+ * @brief Unmaps a column
+ */
+void
+staz_column_unmap(staz_column* col) {
+    if (!col) return;
+
+#if STAZ_HAVE_MMAP
+    if (col->data) munmap((void *)col->data, col->bytes);
+#endif
+
+    memset(col, 0, sizeof(*col));
+}
+
+/**
+ * @brief Returns values [start, start + count) of a column as doubles
+ * 
+ * @param col Pointer to the column
+ * @param start Index of the first value
+ * @param count Number of values
+ * @param scratch Buffer of count doubles, used only when a copy is needed
+ * 
+ * @return const double* Pointer into the mapping itself for float64 data
+ *         on little-endian hosts (zero-copy), otherwise scratch filled with
+ *         the converted values; NULL on error
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if col is not mapped, count is 0 or a needed scratch is NULL
+ *       - RANGEOUT_ERROR if the range is past the end of the column
+ *       - 0 if operation succeeds
+ */
+const double*
+staz_column_chunk(const staz_column* col, size_t start, size_t count, double* scratch) {
+    if (!col || !col->data || count == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NULL;
+    }
+
+    if (start > col->len || count > col->len - start) {
+        errno = RANGEOUT_ERROR;
+        return NULL;
+    }
+
+    const int little = _staz_is_little_endian();
+
+    if (col->type == STAZ_COLUMN_F64 && little) {
+        errno = 0;
+        return (const double *)(const void *)(col->data + start * sizeof(double));
+    }
+
+    if (!scratch) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NULL;
+    }
+
+    const size_t width = _staz_column_width(col->type);
+    const unsigned char* src = col->data + start * width;
+
+    for (size_t i = 0; i < count; i++, src += width) {
+        unsigned char raw[8];
+
+        for (size_t b = 0; b < width; b++) {
+            raw[b] = little ? src[b] : src[width - 1 - b];
+        }
+
+        if (col->type == STAZ_COLUMN_F64) {
+            memcpy(&scratch[i], raw, sizeof(double));
+        } else {
+            float f;
+            memcpy(&f, raw, sizeof(float));
+            scratch[i] = f;
+        }
+    }
+
+    errno = 0;
+    return scratch;
+}
+
+/**
+ * @brief Streams a whole column through a staz_online accumulator
+ * 
+ * @param col Pointer to the column
+ * @param chunk Values per chunk, 0 for STAZ_COLUMN_CHUNK
+ * 
+ * @return staz_online Count, mean, second moment and extremes of the column
+ * 
+ * @note Float64 data on little-endian hosts is reduced in place, with no
+ *       copy. Pages are prefetched one chunk ahead and released once
+ *       reduced, so files larger than RAM stream through.
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if col is not mapped
+ *       - MEMORY_ALLOCATION_ERROR if a conversion buffer cannot be allocated
+ *       - 0 if operation succeeds
+ */
+staz_online
+staz_column_reduce(const staz_column* col, size_t chunk) {
+    staz_online acc = staz_online_create();
+
+    if (!col || !col->data) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return acc;
+    }
+
+    if (chunk == 0) chunk = STAZ_COLUMN_CHUNK;
+
+    double* scratch = NULL;
+    if (col->type != STAZ_COLUMN_F64 || !_staz_is_little_endian()) {
+        const size_t n = (chunk < col->len) ? chunk : col->len;
+
+        scratch = (double *)malloc(n * sizeof(double));
+        if (!scratch) {
+            errno = MEMORY_ALLOCATION_ERROR;
+            return acc;
+        }
+    }
+
+    const size_t width = _staz_column_width(col->type);
+
+    for (size_t start = 0; start < col->len; start += chunk) {
+        const size_t n = (col->len - start < chunk) ? col->len - start : chunk;
+
+#if STAZ_HAVE_MMAP
+        const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+        if (start + n < col->len) {
+            const size_t ahead = (start + n) * width / page * page;
+            const size_t ahead_n = (col->len - start - n < chunk) ? col->len - start - n : chunk;
+            STAZ_MADVISE(col->data + ahead, (start + n + ahead_n) * width - ahead, WILLNEED);
+        }
+#endif
+
+        staz_online_update(&acc, staz_column_chunk(col, start, n, scratch), n);
+
+#if STAZ_HAVE_MMAP
+        // Release the pages of this chunk, keeping the one shared with the next
+        const size_t release = start * width / page * page;
+        const size_t release_end = (start + n) * width / page * page;
+        if (release_end > release) {
+            STAZ_MADVISE(col->data + release, release_end - release, DONTNEED);
+        }
+#endif
+    }
+
+    free(scratch);
+    errno = 0;
+    return acc;
+}
+
+/* --- TEXT INGESTION --- */
+
+#if defined(__GNUC__) || defined(__clang__)
+    #define STAZ_CTZ64(x) ((unsigned)__builtin_ctzll(x))
+#else
+static inline unsigned
+_staz_ctz64(uint64_t x) {
+    unsigned n = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        n++;
+    }
+    return n;
+}
+    #define STAZ_CTZ64(x) _staz_ctz64(x)
+#endif
+
+/**
+ * @brief Finds the first occurrence of either of two bytes
+ * 
+ * @param p Start of the text
+ * @param end End of the text
+ * @param a First byte to look for
+ * @param b Second byte to look for
+ * 
+ * @return const char* Position of the first match, end if none
+ * 
+ * @note Scans 16 bytes per step with SSE2, or 8 bytes per step with
+ *       SIMD-within-a-register arithmetic elsewhere.
+ */
+static inline const char*
+_staz_find2(const char* p, const char* end, char a, char b) {
+#if defined(__SSE2__)
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+
+    for (; end - p >= 16; p += 16) {
+        const __m128i v = _mm_loadu_si128((const __m128i *)(const void *)p);
+        const unsigned mask = (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+
+        if (mask) return p + STAZ_CTZ64(mask);
+    }
+#else
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t highs = 0x8080808080808080ULL;
+    const uint64_t pa = ones * (unsigned char)a;
+    const uint64_t pb = ones * (unsigned char)b;
+
+    for (; end - p >= 8; p += 8) {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+
+        const uint64_t xa = v ^ pa, xb = v ^ pb;
+        const uint64_t hit = ((xa - ones) & ~xa & highs) | ((xb - ones) & ~xb & highs);
+
+        if (hit) break; // the byte loop below pinpoints it
+    }
+#endif
+
+    for (; p < end; p++) {
+        if (*p == a || *p == b) return p;
+    }
+
+    return end;
+}
+
+/** Exact powers of ten representable as doubles */
+static const double _staz_pow10[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/**
+ * @brief Parses a decimal number at the start of [p, end)
+ * 
+ * @param p Start of the text
+ * @param end End of the text (the text need not be NUL-terminated)
+ * @param out Parsed value
+ * 
+ * @return const char* One past the last character parsed, NULL if the
+ *         text does not start with a number
+ * 
+ * @note Numbers with at most 19 significant digits, a mantissa below 2^53
+ *       and a decimal exponent within +-22 are converted with a single
+ *       exact multiplication or division (Clinger's fast path), which is
+ *       correctly rounded. Where long double is the x87 80-bit format, the
+ *       same operation on the full 64-bit mantissa also covers 17 to 19
+ *       digits (what %.17g writes): its one extended rounding is kept
+ *       unless it lands within one unit of a halfway point between
+ *       doubles, where rounding twice could differ from rounding once.
+ *       Anything else (more digits, huge exponents, inf, nan, hex floats,
+ *       ambiguous halfway cases) goes through strtod, which honors the
+ *       locale. Only the token is copied for it: the run of letters,
+ *       digits, signs, points (and the locale's decimal point),
+ *       parentheses and underscores at p, on the heap if it is too long
+ *       for the stack buffer. Leading whitespace, which strtod would
+ *       skip, is rejected.
+ */
+static const char*
+_staz_parse_double(const char* p, const char* end, double* out) {
+    const char* start = p;
+    int negative = 0;
+
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+
+    // Hex floats are left to strtod
+    if (end - p >= 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) p = end;
+
+    uint64_t m = 0;
+    int digits = 0, exp10 = 0, any = 0, truncated = 0;
+
+    for (; p < end && (unsigned)(*p - '0') < 10; p++) {
+        any = 1;
+        if (digits < 19) {
+            m = m * 10 + (unsigned)(*p - '0');
+            digits += (m != 0);
+        } else {
+            exp10++;
+            truncated |= (*p != '0');
+        }
+    }
+
+    if (p < end && *p == '.') {
+        for (p++; p < end && (unsigned)(*p - '0') < 10; p++) {
+            any = 1;
+            if (digits < 19) {
+                m = m * 10 + (unsigned)(*p - '0');
+                digits += (m != 0);
+                exp10--;
+            } else {
+                truncated |= (*p != '0');
+            }
+        }
+    }
+
+    if (any && p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        int eneg = 0, e = 0;
+
+        if (q < end && (*q == '-' || *q == '+')) {
+            eneg = (*q == '-');
+            q++;
+        }
+
+        if (q < end && (unsigned)(*q - '0') < 10) {
+            for (; q < end && (unsigned)(*q - '0') < 10; q++) {
+                if (e < 100000) e = e * 10 + (*q - '0');
+            }
+
+            exp10 += eneg ? -e : e;
+            p = q;
+        }
+    }
+
+    if (any && !truncated && m <= (1ULL << 53) && exp10 >= -22 && exp10 <= 22) {
+        double v = (double)m;
+        v = (exp10 < 0) ? v / _staz_pow10[-exp10] : v * _staz_pow10[exp10];
+
+        *out = negative ? -v : v;
+        return p;
+    }
+
+    if (any && m == 0 && !truncated) {
+        *out = negative ? -0.0 : 0.0;
+        return p;
+    }
+
+#if LDBL_MANT_DIG == 64 && (defined(__x86_64__) || defined(__i386__))
+    if (any && !truncated && exp10 >= -22 && exp10 <= 22) {
+        long double x = (long double)m;
+        x = (exp10 < 0) ? x / (long double)_staz_pow10[-exp10] : x * (long double)_staz_pow10[exp10];
+
+        // The low 11 of the 64 significand bits are what rounding to double drops
+        uint64_t sig;
+        memcpy(&sig, &x, sizeof(sig));
+
+        const unsigned low = (unsigned)(sig & 0x7FF);
+        if (low < 0x3FF || low > 0x401) {
+            *out = negative ? -(double)x : (double)x;
+            return p;
+        }
+    }
+#endif
+
+    // Slow path: strtod on a NUL-terminated copy of the token, which ends
+    // at the first character strtod's grammar cannot use
+    if (start == end || *start == ' ' || (unsigned)(*start - '\t') < 5) return NULL;
+
+    const char point = *localeconv()->decimal_point;
+    const char* stop = start;
+
+    for (; stop < end; stop++) {
+        const char c = *stop;
+        const int word = (unsigned)(c - '0') < 10 || (unsigned)((c | 32) - 'a') < 26 || c == '_';
+
+        if (!word && c != '+' && c != '-' && c != '.' && c != point && c != '(' && c != ')') break;
+    }
+
+    char stack[64];
+    const size_t n = (size_t)(stop - start);
+    char* buf = (n < sizeof(stack)) ? stack : (char *)malloc(n + 1);
+    if (!buf) return NULL;
+
+    memcpy(buf, start, n);
+    buf[n] = '\0';
+
+    char* parsed;
+    const double v = strtod(buf, &parsed);
+    const size_t used = (size_t)(parsed - buf);
+
+    if (buf != stack) free(buf);
+    if (used == 0) return NULL;
+
+    *out = v;
+    return start + used;
+}
+
+/**
+ * @brief Shared line loop of staz_csv_parse and staz_csv_online
+ */
+static size_t
+_staz_csv_parse(const char* text, size_t len, char delim, size_t column,
+                double* out, size_t cap, size_t* consumed) {
+    const char* p = text;
+    const char* end = text + len;
+    size_t n = 0;
+
+    while (p < end && n < cap) {
+        const char* field = p;
+        const char* stop;
+        size_t c = 0;
+
+        // Walk the fields of the line up to the requested column
+        for (;;) {
+            stop = _staz_find2(field, end, delim, '\n');
+            if (c == column || stop == end || *stop == '\n') break;
+            field = stop + 1;
+            c++;
+        }
+
+        const char* eol = (stop == end || *stop == '\n') ? stop : _staz_find2(stop, end, '\n', '\n');
+
+        // In streaming mode an unterminated line waits for the next chunk
+        if (eol == end && consumed) break;
+
+        if (c == column) {
+            while (field < stop && (*field == ' ' || *field == '\t')) field++;
+
+            const char* last = stop;
+            while (last > field && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\r')) last--;
+
+            double v;
+            if (field < last && _staz_parse_double(field, last, &v) == last) out[n++] = v;
+        }
+
+        p = (eol < end) ? eol + 1 : end;
+    }
+
+    if (consumed) *consumed = (size_t)(p - text);
+    return n;
+}
+
+/**
+ * @brief Parses one numeric column of delimited text (CSV, TSV, ...)
+ * 
+ * @param text Pointer to the text, not necessarily NUL-terminated
+ * @param len Length of the text in bytes
+ * @param delim Field delimiter (e.g. ',' or '\t')
+ * @param column Zero-based index of the column to parse
+ * @param out Output array of parsed values
+ * @param cap Capacity of out
+ * @param consumed If NULL, text is the whole input and an unterminated last
+ *        line is parsed too. Otherwise only complete lines are parsed and
+ *        the number of bytes used is stored, so the caller can carry the
+ *        rest over to the next chunk.
+ * 
+ * @return size_t Number of values written to out
+ * 
+ * @note Lines whose field is missing or not a number (headers, blanks)
+ *       are skipped. Fields are not unquoted. Parsing stops early when out is full.
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if text or out is NULL
+ *       - 0 if operation succeeds
+ */
+size_t
+staz_csv_parse(const char* text, size_t len, char delim, size_t column,
+               double* out, size_t cap, size_t* consumed) {
+    if (!text || !out) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return 0;
+    }
+
+    const size_t n = _staz_csv_parse(text, len, delim, column, out, cap, consumed);
+
+    errno = 0; // strtod may have left ERANGE behind
+    return n;
+}
+
+/**
+ * @brief Parses one numeric column of delimited text straight into an accumulator
+ * 
+ * @param text Pointer to the text, not necessarily NUL-terminated
+ * @param len Length of the text in bytes
+ * @param delim Field delimiter (e.g. ',' or '\t')
+ * @param column Zero-based index of the column to parse
+ * @param acc Pointer to the accumulator to update
+ * @param consumed Same meaning as for staz_csv_parse()
+ * 
+ * @return size_t Number of values added to acc
+ * 
+ * @note Values are parsed into a small stack buffer and folded in batches,
+ *       so no heap memory is used whatever the size of the text.
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if text or acc is NULL
+ *       - 0 if operation succeeds
+ */
+size_t
+staz_csv_online(const char* text, size_t len, char delim, size_t column,
+                staz_online* acc, size_t* consumed) {
+    if (!text || !acc) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return 0;
+    }
+
+    double batch[512];
+    size_t total = 0, pos = 0;
+
+    while (pos < len) {
+        size_t used;
+        const size_t n = _staz_csv_parse(text + pos, len - pos, delim, column, batch, 512, &used);
+
+        staz_online_update(acc, batch, n);
+        total += n;
+        pos += used;
+
+        if (used == 0) break; // only an unterminated line is left
+    }
+
+    // Whole-input mode: the unterminated last line is part of the data
+    if (!consumed && pos < len) {
+        const size_t n = _staz_csv_parse(text + pos, len - pos, delim, column, batch, 512, NULL);
+
+        staz_online_update(acc, batch, n);
+        total += n;
+        pos = len;
+    }
+
+    if (consumed) *consumed = pos;
+
+    errno = 0;
+    return total;
+}
+
+/**
+ * @brief Finds the first occurrence of either of two bytes in [p, end)
+ *
+ * @param p Start of the text
+ * @param end End of the text
+ * @param a First byte to look for
+ * @param b Second byte to look for (pass a twice to look for one byte)
+ *
+ * @return const char* Position of the first match, end if none or if p is NULL
+ *
+ * @note The scanner staz_csv_parse() uses to find delimiters and line ends,
+ *       for callers that split lines or fields themselves.
+ */
+const char*
+staz_text_find(const char* p, const char* end, char a, char b) {
+    if (!p || p >= end) return end;
+
+    return _staz_find2(p, end, a, b);
+}
+
+/**
+ * @brief Parses a number at the start of [p, end)
+ *
+ * @param p Start of the text, not necessarily NUL-terminated
+ * @param end End of the text
+ * @param out Parsed value
+ *
+ * @return const char* One past the last character parsed, NULL if the text
+ *         does not start with a number. A whole field is a number when the
+ *         result equals end.
+ *
+ * @note Same conversion as staz_csv_parse(), leading blanks are not skipped.
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if p or out is NULL
+ *       - 0 if operation succeeds
+ */
+const char*
+staz_parse_double(const char* p, const char* end, double* out) {
+    if (!p || !out) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NULL;
+    }
+
+    const char* stop = (p < end) ? _staz_parse_double(p, end, out) : NULL;
+
+    errno = 0; // strtod may have left ERANGE behind
+    return stop;
+}
+
+/* --- ARROW C DATA INTERFACE --- */
+
+/*
+ * Structures of the Arrow C data interface, copied verbatim from the Arrow
+ * specification. The guard lets this header coexist with Arrow's own headers.
+ */
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+    // Array type description
+    const char* format;
+    const char* name;
+    const char* metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema** children;
+    struct ArrowSchema* dictionary;
+
+    // Release callback
+    void (*release)(struct ArrowSchema*);
+    // Opaque producer-specific data
+    void* private_data;
+};
+
+struct ArrowArray {
+    // Array data description
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void** buffers;
+    struct ArrowArray** children;
+    struct ArrowArray* dictionary;
+
+    // Release callback
+    void (*release)(struct ArrowArray*);
+    // Opaque producer-specific data
+    void* private_data;
+};
+
+#endif // ARROW_C_DATA_INTERFACE
+
+/** Values converted or filtered per step by Arrow and masked reductions */
+#define STAZ_COMPACT_BLOCK 1024
+
+/**
+ * @brief Reads up to 64 bits of an LSB-first bitmap starting at any bit
+ * 
+ * @param bits Bitmap
+ * @param pos Index of the first bit
+ * @param n Number of bits to read (1 to 64)
+ * 
+ * @return uint64_t The bits, first one in the lowest position
+ * 
+ * @note Never reads past the byte holding bit pos + n - 1.
+ */
+static inline uint64_t
+_staz_bitmap_word(const uint8_t* bits, size_t pos, size_t n) {
+    const uint8_t* p = bits + pos / 8;
+    const unsigned shift = (unsigned)(pos % 8);
+    const size_t bytes = (shift + n + 7) / 8;
+
+    uint64_t w = 0;
+    for (size_t i = 0; i < bytes && i < 8; i++) w |= (uint64_t)p[i] << (8 * i);
+
+    w >>= shift;
+    if (bytes > 8) w |= (uint64_t)p[8] << (64 - shift);
+
+    return (n < 64) ? w & ((1ULL << n) - 1) : w;
+}
+
+/**
+ * @brief Validity word of up to 64 values
+ * 
+ * @param src Values
+ * @param n Number of values (1 to 64)
+ * @param bits Bitmap, bit pos + i is set if src[i] is valid; NULL if all are
+ * @param pos Bit index of src[0]
+ * @param skip_nan If non-zero, NAN values are invalid too
+ * 
+ * @return uint64_t Bit i set if src[i] is valid
+ */
+static inline uint64_t
+_staz_valid_word(const double* src, size_t n, const uint8_t* bits, size_t pos, int skip_nan) {
+    uint64_t w = bits ? _staz_bitmap_word(bits, pos, n) : (n < 64) ? (1ULL << n) - 1 : ~0ULL;
+
+    if (skip_nan && w) {
+        uint64_t ordered = 0;
+
+#if defined(__AVX512F__)
+        for (size_t j = 0; j < n; j += 8) {
+            const __mmask8 m = (n - j < 8) ? (__mmask8)((1u << (n - j)) - 1) : (__mmask8)0xFF;
+            const __m512d v = _mm512_maskz_loadu_pd(m, src + j);
+
+            ordered |= (uint64_t)_mm512_mask_cmp_pd_mask(m, v, v, _CMP_ORD_Q) << j;
+        }
+#else
+        for (size_t j = 0; j < n; j++) ordered |= (uint64_t)(src[j] == src[j]) << j;
+#endif
+
+        w &= ordered;
+    }
+
+    return w;
+}
+
+/**
+ * @brief Copies the values of src whose bit is set in w to dst
+ * 
+ * @note dst may alias src (compaction in place). Full words are copied in
+ *       bulk and mixed ones compressed 8 lanes at a time with AVX-512 (one
+ *       set bit at a time elsewhere).
+ */
+static inline size_t
+_staz_compact_word(const double* src, size_t n, uint64_t w, double* dst) {
+    if (w == 0) return 0;
+
+    if (w == ((n < 64) ? (1ULL << n) - 1 : ~0ULL)) {
+        if (dst != src) memmove(dst, src, n * sizeof(double));
+        return n;
+    }
+
+    size_t k = 0;
+
+#if defined(__AVX512F__)
+    for (size_t j = 0; j < n; j += 8) {
+        const __mmask8 m = (__mmask8)(w >> j);
+        const __m512d v = _mm512_maskz_loadu_pd(m, src + j);
+
+        _mm512_mask_compressstoreu_pd(dst + k, m, v);
+        k += (size_t)_staz_popcount64(m);
+    }
+#else
+    for (; w; w &= w - 1) dst[k++] = src[STAZ_CTZ64(w)];
+#endif
+
+    return k;
+}
+
+/**
+ * @brief Copies the valid values of an array
+ * 
+ * @param src Values
+ * @param len Number of values
+ * @param bits Bitmap, bit pos + i is set if src[i] is valid; NULL if all are
+ * @param pos Bit index of src[0]
+ * @param skip_nan If non-zero, NAN values are dropped too
+ * @param dst Destination, may be src itself (compaction in place)
+ * 
+ * @return size_t Number of values copied
+ * 
+ * @note Validity is processed one 64-bit word at a time: empty words are
+ *       skipped and full ones copied in bulk.
+ */
+static size_t
+_staz_compact(const double* src, size_t len, const uint8_t* bits, size_t pos, int skip_nan, double* dst) {
+    size_t k = 0;
+
+    for (size_t i = 0; i < len; i += 64) {
+        const size_t n = (len - i < 64) ? len - i : 64;
+        const uint64_t w = _staz_valid_word(src + i, n, bits, pos + i, skip_nan);
+
+        k += _staz_compact_word(src + i, n, w, dst + k);
+    }
+
+    return k;
+}
+
+/**
+ * @brief Returns the Arrow format character of a supported numeric array, 0 otherwise
+ */
+static char
+_staz_arrow_format(const struct ArrowSchema* schema, const struct ArrowArray* array) {
+    if (!schema || !array || !schema->format || !array->release) return 0;
+    if (array->length < 0 || array->offset < 0 || array->n_buffers != 2 || !array->buffers) return 0;
+    if (array->length > 0 && !array->buffers[1]) return 0;
+
+    const char f = schema->format[0];
+    if (f == '\0' || schema->format[1] != '\0' || !strchr("gfcsilCSIL", f)) return 0;
+
+    return f;
+}
+
+/**
+ * @brief Converts count elements of an Arrow value buffer, from element start, to double
+ * 
+ * @note 64-bit integers beyond 2^53 are rounded to the nearest double.
+ */
+static void
+_staz_arrow_convert(char format, const void* buf, size_t start, size_t count, double* out) {
+    #define STAZ_ARROW_CONVERT(T) \
+        for (size_t i = 0; i < count; i++) out[i] = (double)((const T *)buf)[start + i]; \
+        break
+
+    switch (format) {
+        case 'g': memcpy(out, (const double *)buf + start, count * sizeof(double)); break;
+        case 'f': STAZ_ARROW_CONVERT(float);
+        case 'c': STAZ_ARROW_CONVERT(int8_t);
+        case 's': STAZ_ARROW_CONVERT(int16_t);
+        case 'i': STAZ_ARROW_CONVERT(int32_t);
+        case 'l': STAZ_ARROW_CONVERT(int64_t);
+        case 'C': STAZ_ARROW_CONVERT(uint8_t);
+        case 'S': STAZ_ARROW_CONVERT(uint16_t);
+        case 'I': STAZ_ARROW_CONVERT(uint32_t);
+        case 'L': STAZ_ARROW_CONVERT(uint64_t);
+        default: break;
+    }
+
+    #undef STAZ_ARROW_CONVERT
+}
+
+/**
+ * @brief Validity bitmap of an Arrow array, NULL if every slot is valid
+ */
+static inline const uint8_t*
+_staz_arrow_validity(const struct ArrowArray* array) {
+    if (array->null_count == 0) return NULL;
+    return (const uint8_t *)array->buffers[0];
+}
+
+/**
+ * @brief Folds the non-null values of a validated Arrow array into acc
+ */
+static void
+_staz_arrow_reduce(char format, const struct ArrowArray* array, staz_online* acc) {
+    const size_t len = (size_t)array->length;
+    const size_t offset = (size_t)array->offset;
+    const uint8_t* validity = _staz_arrow_validity(array);
+    const void* values = array->buffers[1];
+
+    // Dense float64 is reduced straight from the Arrow buffer
+    if (format == 'g' && !validity) {
+        staz_online_update(acc, (const double *)values + offset, len);
+        return;
+    }
+
+    double block[STAZ_COMPACT_BLOCK];
+
+    for (size_t i = 0; i < len; i += STAZ_COMPACT_BLOCK) {
+        const size_t n = (len - i < STAZ_COMPACT_BLOCK) ? len - i : STAZ_COMPACT_BLOCK;
+        const double* src = block;
+        size_t k = n;
+
+        if (format == 'g') {
+            src = (const double *)values + offset + i;
+        } else {
+            _staz_arrow_convert(format, values, offset + i, n, block);
+        }
+
+        if (validity) {
+            k = _staz_compact(src, n, validity, offset + i, 0, block);
+            src = block;
+        }
+
+        staz_online_update(acc, src, k);
+    }
+}
+
+/**
+ * @brief Copies the non-null values of an Arrow numeric array as doubles
+ * 
+ * @param schema Pointer to the schema of the array
+ * @param array Pointer to the array
+ * @param out Output array with room for array->length values
+ * 
+ * @return size_t Number of values written, 0 on error
+ * 
+ * @note Supported formats are float64 ("g"), float32 ("f") and the signed
+ *       and unsigned integers ("c", "s", "i", "l", "C", "S", "I", "L").
+ *       The array offset and validity bitmap are honored. The output can
+ *       then be passed to any function, e.g. staz_quantiles().
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if an argument is NULL, the array is released or its type is not supported
+ *       - 0 if operation succeeds
+ */
+size_t
+staz_arrow_values(const struct ArrowSchema* schema, const struct ArrowArray* array, double* out) {
+    const char format = _staz_arrow_format(schema, array);
+
+    if (!format || !out) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return 0;
+    }
+
+    const size_t len = (size_t)array->length;
+    const size_t offset = (size_t)array->offset;
+    const uint8_t* validity = _staz_arrow_validity(array);
+
+    errno = 0;
+
+    if (format == 'g' && validity) {
+        return _staz_compact((const double *)array->buffers[1] + offset, len, validity, offset, 0, out);
+    }
+
+    _staz_arrow_convert(format, array->buffers[1], offset, len, out);
+
+    return validity ? _staz_compact(out, len, validity, offset, 0, out) : len;
+}
+
+/**
+ * @brief Streams an Arrow numeric array through a staz_online accumulator
+ * 
+ * @param schema Pointer to the schema of the array
+ * @param array Pointer to the array
+ * 
+ * @return staz_online Count, mean, second moment and extremes of the non-null values
+ * 
+ * @note Works on the Arrow buffers in place: dense float64 is reduced with
+ *       no copy, other types are converted in small stack blocks, and
+ *       nulls are dropped word by word from the validity bitmap.
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if an argument is NULL, the array is released or its type is not supported
+ *       - 0 if operation succeeds
+ */
+staz_online
+staz_arrow_online(const struct ArrowSchema* schema, const struct ArrowArray* array) {
+    staz_online acc = staz_online_create();
+    const char format = _staz_arrow_format(schema, array);
+
+    if (!format) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return acc;
+    }
+
+    _staz_arrow_reduce(format, array, &acc);
+
+    errno = 0;
+    return acc;
+}
+
+/**
+ * @brief Streams the chunks of a chunked Arrow column through a staz_online accumulator
+ * 
+ * @param schema Pointer to the schema shared by every chunk
+ * @param chunks Array of chunks
+ * @param count Number of chunks
+ * 
+ * @return staz_online Count, mean, second moment and extremes of the non-null values
+ * 
+ * @note Chunks are reduced in parallel (with OpenMP) and merged in order.
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if an argument is NULL, a chunk is released or the type is not supported
+ *       - MEMORY_ALLOCATION_ERROR if memory allocation fails
+ *       - 0 if operation succeeds
+ */
+staz_online
+staz_arrow_online_chunked(const struct ArrowSchema* schema, const struct ArrowArray* chunks, size_t count) {
+    staz_online acc = staz_online_create();
+
+    if (!chunks && count > 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return acc;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (!_staz_arrow_format(schema, &chunks[i])) {
+            errno = INVALID_PARAMETERS_ERROR;
+            return acc;
+        }
+    }
+
+    if (count == 0) {
+        errno = 0;
+        return acc;
+    }
+
+    staz_online* parts = (staz_online *)malloc(count * sizeof(staz_online));
+    if (!parts) {
+        errno = MEMORY_ALLOCATION_ERROR;
+        return acc;
+    }
+
+    const char format = schema->format[0];
+
+    STAZ_OMP(omp parallel for schedule(dynamic, 1) if (count > 1))
+    for (size_t i = 0; i < count; i++) {
+        parts[i] = staz_online_create();
+        _staz_arrow_reduce(format, &chunks[i], &parts[i]);
+    }
+
+    for (size_t i = 0; i < count; i++) staz_online_merge(&acc, &parts[i]);
+
+    free(parts);
+    errno = 0;
+    return acc;
+}
+
+/* --- MISSING VALUES --- */
+
+/**
+ * @brief Shared kernel of the NAN-skipping and masked reductions
+ * 
+ * @param nums Values
+ * @param len Number of values
+ * @param bits Validity bitmap (bit i for nums[i]), NULL if all are valid
+ * @param skip_nan If non-zero, NAN values are skipped too
+ * @param sum If not NULL, receives the sum of the valid values
+ * @param acc If not NULL, the valid values are folded into it
+ * 
+ * @return size_t Number of valid values
+ * 
+ * @note Works in blocks of STAZ_COMPACT_BLOCK values. A block whose
+ *       validity words are all full is reduced in place; only blocks with
+ *       missing values are compacted into a stack buffer first.
+ */
+static size_t
+_staz_masked_moments(const double* nums, size_t len, const uint8_t* bits, int skip_nan,
+                     double* sum, staz_online* acc) {
+    double block[STAZ_COMPACT_BLOCK];
+    uint64_t words[STAZ_COMPACT_BLOCK / 64];
+    double total = 0.0;
+    size_t count = 0;
+
+    for (size_t i = 0; i < len; i += STAZ_COMPACT_BLOCK) {
+        const size_t n = (len - i < STAZ_COMPACT_BLOCK) ? len - i : STAZ_COMPACT_BLOCK;
+        const double* src = nums + i;
+        int full = 1;
+
+        for (size_t j = 0; j < n; j += 64) {
+            const size_t m = (n - j < 64) ? n - j : 64;
+
+            words[j / 64] = _staz_valid_word(src + j, m, bits, i + j, skip_nan);
+            full &= (words[j / 64] == ((m < 64) ? (1ULL << m) - 1 : ~0ULL));
+        }
+
+        size_t k = n;
+        if (!full) {
+            k = 0;
+            for (size_t j = 0; j < n; j += 64) {
+                const size_t m = (n - j < 64) ? n - j : 64;
+                k += _staz_compact_word(src + j, m, words[j / 64], block + k);
+            }
+            src = block;
+        }
+
+        if (k == 0) continue;
+
+        if (sum) total += _staz_sum_recursive(src, 0, k - 1);
+        if (acc) staz_online_update(acc, src, k);
+        count += k;
+    }
+
+    if (sum) *sum = total;
+    return count;
+}
+
+/**
+ * @brief Shared kernel of the NAN-skipping and masked regressions
+ * 
+ * @note A pair is valid if its bit is set (when bits is given) and, with
+ *       skip_nan, neither coordinate is NAN. Each block of valid pairs is
+ *       reduced with two passes and merged with Chan's update, so the
+ *       centered co-moments keep their accuracy on offset data.
+ * 
+ * @return size_t Number of valid pairs
+ */
+static size_t
+_staz_masked_line_moments(const double* x, const double* y, size_t len, const uint8_t* bits, int skip_nan,
+                          double* mean_x, double* mean_y, double* sxx, double* sxy) {
+    double bx[STAZ_COMPACT_BLOCK], by[STAZ_COMPACT_BLOCK];
+    double mx = 0.0, my = 0.0, cxx = 0.0, cxy = 0.0;
+    size_t count = 0;
+
+    for (size_t i = 0; i < len; i += STAZ_COMPACT_BLOCK) {
+        const size_t n = (len - i < STAZ_COMPACT_BLOCK) ? len - i : STAZ_COMPACT_BLOCK;
+        size_t k = 0;
+
+        for (size_t j = 0; j < n; j += 64) {
+            const size_t m = (n - j < 64) ? n - j : 64;
+            uint64_t w = _staz_valid_word(x + i + j, m, bits, i + j, skip_nan);
+            if (skip_nan) w &= _staz_valid_word(y + i + j, m, NULL, 0, 1);
+
+            _staz_compact_word(x + i + j, m, w, bx + k);
+            k += _staz_compact_word(y + i + j, m, w, by + k);
+        }
+
+        if (k == 0) continue;
+
+        double bmx = 0.0, bmy = 0.0;
+        for (size_t j = 0; j < k; j++) {
+            bmx += bx[j];
+            bmy += by[j];
+        }
+        bmx /= k;
+        bmy /= k;
+
+        double bxx = 0.0, bxy = 0.0;
+        for (size_t j = 0; j < k; j++) {
+            const double dx = bx[j] - bmx;
+            bxx += dx * dx;
+            bxy += dx * (by[j] - bmy);
+        }
+
+        const size_t total = count + k;
+        const double dx = bmx - mx, dy = bmy - my;
+        const double w = (double)count * k / total;
+
+        mx += dx * k / total;
+        my += dy * k / total;
+        cxx += bxx + dx * dx * w;
+        cxy += bxy + dx * dy * w;
+        count = total;
+    }
+
+    *mean_x = mx;
+    *mean_y = my;
+    *sxx = cxx;
+    *sxy = cxy;
+    return count;
+}
+
+static double
+_staz_masked_sum(const double* nums, size_t len, const uint8_t* bits, int skip_nan) {
+    double sum;
+    _staz_masked_moments(nums, len, bits, skip_nan, &sum, NULL);
+
+    errno = 0;
+    return sum;
+}
+
+/**
+ * @brief Moments of the valid values; sets errno and returns 0 if there are none
+ */
+static int
+_staz_masked_online(const double* nums, size_t len, const uint8_t* bits, int skip_nan, staz_online* acc) {
+    *acc = staz_online_create();
+
+    if (_staz_masked_moments(nums, len, bits, skip_nan, NULL, acc) == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return 0;
+    }
+
+    errno = 0;
+    return 1;
+}
+
+static staz_line_equation
+_staz_masked_line(const double* x, const double* y, size_t len, const uint8_t* bits, int skip_nan) {
+    double mx, my, sxx, sxy;
+
+    if (_staz_masked_line_moments(x, y, len, bits, skip_nan, &mx, &my, &sxx, &sxy) == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return (staz_line_equation) {NAN, NAN};
+    }
+
+    if (sxx == 0) {
+        errno = ZERO_DIVISION_ERROR;
+        return (staz_line_equation) {NAN, NAN};
+    }
+
+    errno = 0;
+
+    const double m = sxy / sxx;
+    return (staz_line_equation) {m, my - m * mx};
+}
+
+/**
+ * @brief Sum of the non-NAN values of an array
+ * 
+ * @param nums Pointer to the array of double values
+ * @param len Length of the array
+ * 
+ * @return double The sum, 0 if every value is NAN; NAN if nums is NULL or len is 0
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if nums is NULL or len is 0
+ *       - 0 if operation succeeds
+ */
+double
+staz_nansum(const double* nums, size_t len) {
+    if (!nums || len == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    return _staz_masked_sum(nums, len, NULL, 1);
+}
+
+/**
+ * @brief Arithmetic mean of the non-NAN values of an array
+ * 
+ * @param nums Pointer to the array of double values
+ * @param len Length of the array
+ * 
+ * @return double The mean, NAN if there is no non-NAN value
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if nums is NULL, len is 0 or every value is NAN
+ *       - 0 if operation succeeds
+ */
+double
+staz_nanmean(const double* nums, size_t len) {
+    staz_online acc;
+
+    if (!nums || !_staz_masked_online(nums, len, NULL, 1, &acc)) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    return acc.mean;
+}
+
+/**
+ * @brief Population variance of the non-NAN values of an array
+ * 
+ * @param nums Pointer to the array of double values
+ * @param len Length of the array
+ * 
+ * @return double The variance, NAN if there is no non-NAN value
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if nums is NULL, len is 0 or every value is NAN
+ *       - 0 if operation succeeds
+ */
+double
+staz_nanvariance(const double* nums, size_t len) {
+    staz_online acc;
+
+    if (!nums || !_staz_masked_online(nums, len, NULL, 1, &acc)) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    return acc.m2 / acc.n;
+}
+
+/**
+ * @brief Minimum of the non-NAN values of an array
+ * 
+ * @param nums Pointer to the array of double values
+ * @param len Length of the array
+ * 
+ * @return double The minimum, NAN if there is no non-NAN value
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if nums is NULL, len is 0 or every value is NAN
+ *       - 0 if operation succeeds
+ */
+double
+staz_nanmin_value(const double* nums, size_t len) {
+    staz_online acc;
+
+    if (!nums || !_staz_masked_online(nums, len, NULL, 1, &acc)) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    return acc.min;
+}
+
+/**
+ * @brief Maximum of the non-NAN values of an array
+ * 
+ * @param nums Pointer to the array of double values
+ * @param len Length of the array
+ * 
+ * @return double The maximum, NAN if there is no non-NAN value
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if nums is NULL, len is 0 or every value is NAN
+ *       - 0 if operation succeeds
+ */
+double
+staz_nanmax_value(const double* nums, size_t len) {
+    staz_online acc;
+
+    if (!nums || !_staz_masked_online(nums, len, NULL, 1, &acc)) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    return acc.max;
+}
+
+/**
+ * @brief Quantile of the non-NAN values of an array
+ * 
+ * @param mtype Quantile division (e.g., 1000, 20, 30, 4)
+ * @param posx Position of the quantile (range: 1 to mtype-1)
+ * @param nums Pointer to the array of double values, left unchanged
+ * @param len Length of the array
+ * 
+ * @return double The quantile, NAN if input is invalid or every value is NAN
+ * 
+ * @note The non-NAN values are copied into a scratch buffer in one
+ *       branchless pass (on the stack up to STAZ_SMALL_MAX values), the
+ *       quantile is then selected among them as by staz_quantile.
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if nums is NULL, len or posx is invalid or every value is NAN
+ *       - RANGEOUT_ERROR if posx is invalid for mtype
+ *       - MEMORY_ALLOCATION_ERROR if memory allocation fails
+ *       - 0 if operation succeeds
+ */
+double
+staz_nanquantile(int mtype, size_t posx, const double* nums, size_t len) {
+    if (!nums || len == 0 || posx < 1) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    /* Measure type must be between 1 and mtype-1 */
+    if (posx > (size_t)mtype - 1) {
+        errno = RANGEOUT_ERROR;
+        return NAN;
+    }
+
+    double buf[STAZ_SMALL_MAX];
+    double* copy = (len <= STAZ_SMALL_MAX) ? buf : (double *)malloc(len * sizeof(double));
+    if (!copy) {
+        errno = MEMORY_ALLOCATION_ERROR;
+        return NAN;
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        copy[n] = nums[i];
+        n += !isnan(nums[i]);
+    }
+
+    double qu = NAN;
+
+    if (n == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+    } else {
+        errno = 0;
+        _staz_quantiles(copy, n, mtype, &posx, 1, &qu);
+    }
+
+    if (copy != buf) free(copy);
+    return qu;
+}
+
+/**
+ * @brief Linear regression over the pairs where neither coordinate is NAN
+ * 
+ * @param x Pointer to the array of x coordinates
+ * @param y Pointer to the array of y coordinates
+ * @param len Length of both arrays
+ * 
+ * @return staz_line_equation Slope m and intercept q, both NAN on error
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if x or y is NULL, len is 0 or no pair is valid
+ *       - ZERO_DIVISION_ERROR if the valid x values are all equal
+ *       - 0 if operation succeeds
+ */
+staz_line_equation
+staz_nanlinear_regression(const double* x, const double* y, size_t len) {
+    if (!x || !y || len == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return (staz_line_equation) {NAN, NAN};
+    }
+
+    return _staz_masked_line(x, y, len, NULL, 1);
+}
+
+/**
+ * @brief Sum of the values of an array selected by a validity bitmap
+ * 
+ * @param nums Pointer to the array of double values
+ * @param len Length of the array
+ * @param valid Bitmap, least significant bit first: bit i is set if nums[i] is valid
+ * 
+ * @return double The sum, 0 if no value is valid; NAN if input is invalid
+ * 
+ * @note The bitmap layout is the one of Arrow validity buffers.
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if nums or valid is NULL or len is 0
+ *       - 0 if operation succeeds
+ */
+double
+staz_masked_sum(const double* nums, size_t len, const uint8_t* valid) {
+    if (!nums || !valid || len == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    return _staz_masked_sum(nums, len, valid, 0);
+}
+
+/**
+ * @brief Arithmetic mean of the values of an array selected by a validity bitmap
+ * 
+ * @param nums Pointer to the array of double values
+ * @param len Length of the array
+ * @param valid Bitmap, least significant bit first: bit i is set if nums[i] is valid
+ * 
+ * @return double The mean, NAN if no value is valid
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if nums or valid is NULL, len is 0 or no value is valid
+ *       - 0 if operation succeeds
+ */
+double
+staz_masked_mean(const double* nums, size_t len, const uint8_t* valid) {
+    staz_online acc;
+
+    if (!nums || !valid || !_staz_masked_online(nums, len, valid, 0, &acc)) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    return acc.mean;
+}
+
+/**
+ * @brief Population variance of the values of an array selected by a validity bitmap
+ * 
+ * @param nums Pointer to the array of double values
+ * @param len Length of the array
+ * @param valid Bitmap, least significant bit first: bit i is set if nums[i] is valid
+ * 
+ * @return double The variance, NAN if no value is valid
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if nums or valid is NULL, len is 0 or no value is valid
+ *       - 0 if operation succeeds
+ */
+double
+staz_masked_variance(const double* nums, size_t len, const uint8_t* valid) {
+    staz_online acc;
+
+    if (!nums || !valid || !_staz_masked_online(nums, len, valid, 0, &acc)) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    return acc.m2 / acc.n;
+}
+
+/**
+ * @brief Minimum of the values of an array selected by a validity bitmap
+ * 
+ * @param nums Pointer to the array of double values
+ * @param len Length of the array
+ * @param valid Bitmap, least significant bit first: bit i is set if nums[i] is valid
+ * 
+ * @return double The minimum, NAN if no value is valid
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if nums or valid is NULL, len is 0 or no value is valid
+ *       - 0 if operation succeeds
+ */
+double
+staz_masked_min_value(const double* nums, size_t len, const uint8_t* valid) {
+    staz_online acc;
+
+    if (!nums || !valid || !_staz_masked_online(nums, len, valid, 0, &acc)) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    return acc.min;
+}
+
+/**
+ * @brief Maximum of the values of an array selected by a validity bitmap
+ * 
+ * @param nums Pointer to the array of double values
+ * @param len Length of the array
+ * @param valid Bitmap, least significant bit first: bit i is set if nums[i] is valid
+ * 
+ * @return double The maximum, NAN if no value is valid
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if nums or valid is NULL, len is 0 or no value is valid
+ *       - 0 if operation succeeds
+ */
+double
+staz_masked_max_value(const double* nums, size_t len, const uint8_t* valid) {
+    staz_online acc;
+
+    if (!nums || !valid || !_staz_masked_online(nums, len, valid, 0, &acc)) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    return acc.max;
+}
+
+/**
+ * @brief Quantile of the values of an array selected by a validity bitmap
+ * 
+ * @param mtype Quantile division (e.g., 1000, 20, 30, 4)
+ * @param posx Position of the quantile (range: 1 to mtype-1)
+ * @param nums Pointer to the array of double values, left unchanged
+ * @param len Length of the array
+ * @param valid Bitmap, least significant bit first: bit i is set if nums[i] is valid
+ * 
+ * @return double The quantile, NAN if input is invalid or no value is valid
+ * 
+ * @note The valid values are compacted into a buffer, then selected as by staz_quantile.
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if nums or valid is NULL, len or posx is invalid or no value is valid
+ *       - RANGEOUT_ERROR if posx is invalid for mtype
+ *       - MEMORY_ALLOCATION_ERROR if memory allocation fails
+ *       - 0 if operation succeeds
+ */
+double
+staz_masked_quantile(int mtype, size_t posx, const double* nums, size_t len, const uint8_t* valid) {
+    if (!nums || !valid || len == 0 || posx < 1) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    /* Measure type must be between 1 and mtype-1 */
+    if (posx > (size_t)mtype - 1) {
+        errno = RANGEOUT_ERROR;
+        return NAN;
+    }
+
+    double* copy = (double *)malloc(len * sizeof(double));
+    if (!copy) {
+        errno = MEMORY_ALLOCATION_ERROR;
+        return NAN;
+    }
+
+    const size_t n = _staz_compact(nums, len, valid, 0, 0, copy);
+    double qu = NAN;
+
+    if (n == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+    } else {
+        errno = 0;
+        _staz_quantiles(copy, n, mtype, &posx, 1, &qu);
+    }
+
+    free(copy);
+    return qu;
+}
+
+/**
+ * @brief Linear regression over the pairs selected by a validity bitmap
+ * 
+ * @param x Pointer to the array of x coordinates
+ * @param y Pointer to the array of y coordinates
+ * @param len Length of both arrays
+ * @param valid Bitmap, least significant bit first: bit i is set if pair i is valid
+ * 
+ * @return staz_line_equation Slope m and intercept q, both NAN on error
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if x, y or valid is NULL, len is 0 or no pair is valid
+ *       - ZERO_DIVISION_ERROR if the valid x values are all equal
+ *       - 0 if operation succeeds
+ */
+staz_line_equation
+staz_masked_linear_regression(const double* x, const double* y, size_t len, const uint8_t* valid) {
+    if (!x || !y || !valid || len == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return (staz_line_equation) {NAN, NAN};
+    }
+
+    return _staz_masked_line(x, y, len, valid, 0);
+}
+
+/* --- STREAMING I/O --- */
+
+/** Bytes per chunk used by the stream readers when none is given */
+#ifndef STAZ_STREAM_CHUNK
+#define STAZ_STREAM_CHUNK (1u << 22)
+#endif
+
+/** Chunks in flight used by the stream readers when no depth is given */
+#ifndef STAZ_STREAM_DEPTH
+#define STAZ_STREAM_DEPTH 2
+#endif
+
+/** Yields a waiting stream thread makes before it starts sleeping */
+#ifndef STAZ_STREAM_SPINS
+#define STAZ_STREAM_SPINS 64
+#endif
+
+/**
+ * @brief Chunk callback of staz_stream_fd
+ * 
+ * @param data Chunk contents
+ * @param bytes Chunk size; every chunk but the last holds exactly the chunk size
+ * @param ctx User pointer given to staz_stream_fd
+ * 
+ * @return int 0 to continue, non-zero to stop the stream
+ */
+typedef int (*staz_stream_fn)(const unsigned char* data, size_t bytes, void* ctx);
+
+#if STAZ_HAVE_MMAP
+
+/**
+ * @brief Reads len bytes at offset off, fewer only at end of file
+ * 
+ * @return int 1 on success, 0 on read error
+ */
+static int
+_staz_pread_full(int fd, unsigned char* buf, size_t len, off_t off, size_t* got) {
+    size_t n = 0;
+
+    while (n < len) {
+        const ssize_t r = STAZ_PREAD(fd, buf + n, len - n, off + (off_t)n);
+
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        if (r == 0) break;
+
+        n += (size_t)r;
+    }
+
+    *got = n;
+    return 1;
+}
+
+#endif
+
+#ifdef _OPENMP
+static inline size_t
+_staz_atomic_load(const size_t* p) {
+    size_t v;
+    STAZ_OMP(omp atomic read seq_cst)
+    v = *p;
+    return v;
+}
+
+static inline void
+_staz_atomic_store(size_t* p, size_t v) {
+    (void)v; // GCC does not see the use of v inside an atomic write
+    STAZ_OMP(omp atomic write seq_cst)
+    *p = v;
+}
+
+/*
+ * A waiting stream thread first yields the CPU for STAZ_STREAM_SPINS rounds,
+ * so short waits stay cheap and the pipeline also works on one core. It then
+ * sleeps, doubling the delay from 1 us up to about 1 ms, so a long wait on
+ * a slow disk or a slow callback does not keep a core busy. *rounds counts
+ * the rounds of the current wait and is reset by the caller on progress.
+ */
+static inline void
+_staz_spin_wait(unsigned* rounds) {
+#if STAZ_HAVE_MMAP
+    if (*rounds < STAZ_STREAM_SPINS) {
+        (*rounds)++;
+        sched_yield();
+        return;
+    }
+
+#if STAZ_HAVE_NANOSLEEP
+    const unsigned shift = *rounds - STAZ_STREAM_SPINS;
+    struct timespec delay;
+    delay.tv_sec = 0;
+    delay.tv_nsec = 1000L << shift;
+
+    if (shift < 10) (*rounds)++;
+    nanosleep(&delay, NULL);
+#else
+    sched_yield();
+#endif
+#else
+    (void)rounds;
+#endif
+}
+#endif
+
+/**
+ * @brief Streams a file through a callback, reading ahead while it runs
+ * 
+ * @param fd File descriptor opened for reading (pread is used, so the
+ *        file offset is not moved and the file must be seekable)
+ * @param chunk Bytes per chunk, 0 for STAZ_STREAM_CHUNK
+ * @param depth Number of chunk buffers, 0 for STAZ_STREAM_DEPTH
+ * @param fn Callback invoked on each chunk, in file order
+ * @param ctx User pointer passed to fn
+ * 
+ * @return size_t Number of bytes handed to fn
+ * 
+ * @note With OpenMP and a depth of at least 2, a reader thread fills a
+ *       ring of depth buffers while fn consumes them on another thread,
+ *       so I/O overlaps the reduction; a thread that has to wait yields,
+ *       then sleeps (see STAZ_STREAM_SPINS). Otherwise chunks are read and
+ *       processed in turn. fn is never called concurrently.
+ *       Only available on POSIX systems.
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if fd is negative or fn is NULL
+ *       - MEMORY_ALLOCATION_ERROR if buffer allocation fails
+ *       - IO_ERROR if a read fails or pread is unavailable
+ *       - 0 if operation succeeds (including when fn stops the stream)
+ */
+size_t
+staz_stream_fd(int fd, size_t chunk, size_t depth, staz_stream_fn fn, void* ctx) {
+    if (fd < 0 || !fn) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return 0;
+    }
+
+#if STAZ_HAVE_MMAP
+    if (chunk == 0) chunk = STAZ_STREAM_CHUNK;
+    if (depth == 0) depth = STAZ_STREAM_DEPTH;
+
+    if (depth > SIZE_MAX / chunk) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return 0;
+    }
+
+    unsigned char* ring = (unsigned char *)malloc(chunk * depth);
+    size_t* sizes = (size_t *)malloc(depth * sizeof(size_t));
+
+    if (!ring || !sizes) {
+        free(ring);
+        free(sizes);
+        errno = MEMORY_ALLOCATION_ERROR;
+        return 0;
+    }
+
+    size_t delivered = 0;
+    int failed = 0;
+    int serial = 1;
+
+#ifdef _OPENMP
+    if (depth >= 2) {
+        size_t produced = 0, consumed = 0, finished = 0, stop = 0;
+
+        STAZ_OMP(omp parallel num_threads(2))
+        {
+            if (omp_get_num_threads() == 2) {
+                if (omp_get_thread_num() == 0) {
+                    // Reader: fill free slots until end of file, an error or a stop
+                    for (off_t off = 0;; off += (off_t)chunk) {
+                        const size_t p = _staz_atomic_load(&produced);
+                        unsigned rounds = 0;
+
+                        while (p - _staz_atomic_load(&consumed) == depth && !_staz_atomic_load(&stop)) {
+                            _staz_spin_wait(&rounds);
+                        }
+                        if (_staz_atomic_load(&stop)) break;
+
+                        size_t got;
+                        if (!_staz_pread_full(fd, ring + (p % depth) * chunk, chunk, off, &got)) {
+                            failed = 1;
+                            break;
+                        }
+                        if (got == 0) break;
+
+                        sizes[p % depth] = got;
+                        _staz_atomic_store(&produced, p + 1);
+
+                        if (got < chunk) break;
+                    }
+
+                    _staz_atomic_store(&finished, 1);
+                    serial = 0;
+                } else {
+                    // Consumer: hand filled slots to fn in order
+                    unsigned rounds = 0;
+
+                    for (size_t c = 0;; ) {
+                        if (c == _staz_atomic_load(&produced)) {
+                            if (_staz_atomic_load(&finished) && c == _staz_atomic_load(&produced)) break;
+                            _staz_spin_wait(&rounds);
+                            continue;
+                        }
+
+                        rounds = 0;
+
+                        const size_t slot = c % depth;
+                        delivered += sizes[slot];
+
+                        if (fn(ring + slot * chunk, sizes[slot], ctx)) {
+                            _staz_atomic_store(&stop, 1);
+                            break;
+                        }
+
+                        _staz_atomic_store(&consumed, ++c);
+                    }
+                }
+            }
+        }
+    }
+#endif
+
+    if (serial) {
+        for (off_t off = 0;; off += (off_t)chunk) {
+            size_t got;
+            if (!_staz_pread_full(fd, ring, chunk, off, &got)) {
+                failed = 1;
+                break;
+            }
+            if (got == 0) break;
+
+            delivered += got;
+            if (fn(ring, got, ctx) || got < chunk) break;
+        }
+    }
+
+    free(ring);
+    free(sizes);
+
+    errno = failed ? IO_ERROR : 0;
+    return delivered;
+#else
+    (void)chunk;
+    (void)depth;
+    (void)ctx;
+    errno = IO_ERROR;
+    return 0;
+#endif
+}
+
+/**
+ * @brief State of the staz_stream_online callback
+ */
+typedef struct {
+    staz_online* acc;
+    staz_column_type type;
+    double* scratch;
+} _staz_stream_online_ctx;
+
+static int
+_staz_stream_online_fn(const unsigned char* data, size_t bytes, void* ctx) {
+    const _staz_stream_online_ctx* s = (const _staz_stream_online_ctx *)ctx;
+    const size_t width = _staz_column_width(s->type);
+
+    // Reuse the column decoder on the chunk (zero-copy for float64)
+    staz_column col;
+    col.data = data;
+    col.bytes = bytes;
+    col.len = bytes / width;
+    col.type = s->type;
+
+    if (col.len > 0) staz_online_update(s->acc, staz_column_chunk(&col, 0, col.len, s->scratch), col.len);
+    return 0;
+}
+
+/**
+ * @brief Streams a raw little-endian column file through a staz_online accumulator
+ * 
+ * @param fd File descriptor opened for reading
+ * @param type Element type of the file
+ * @param chunk Bytes per chunk, 0 for STAZ_STREAM_CHUNK (rounded down to whole elements)
+ * @param depth Number of chunk buffers, 0 for STAZ_STREAM_DEPTH
+ * 
+ * @return staz_online Count, mean, second moment and extremes of the column
+ * 
+ * @note Same layout as staz_column_map(), for files that should not be
+ *       mapped. Reading overlaps the reduction as in staz_stream_fd(). A
+ *       trailing partial element is ignored.
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if fd is negative or chunk is smaller than an element
+ *       - MEMORY_ALLOCATION_ERROR if memory allocation fails
+ *       - IO_ERROR if a read fails or pread is unavailable
+ *       - 0 if operation succeeds
+ */
+staz_online
+staz_stream_online(int fd, staz_column_type type, size_t chunk, size_t depth) {
+    staz_online acc = staz_online_create();
+    const size_t width = _staz_column_width(type);
+
+    if (chunk == 0) chunk = STAZ_STREAM_CHUNK;
+    chunk -= chunk % width;
+
+    if (fd < 0 || chunk == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return acc;
+    }
+
+    _staz_stream_online_ctx ctx;
+    ctx.acc = &acc;
+    ctx.type = type;
+    ctx.scratch = NULL;
+
+    if (type != STAZ_COLUMN_F64 || !_staz_is_little_endian()) {
+        ctx.scratch = (double *)malloc(chunk / width * sizeof(double));
+        if (!ctx.scratch) {
+            errno = MEMORY_ALLOCATION_ERROR;
+            return acc;
+        }
+    }
+
+    staz_stream_fd(fd, chunk, depth, _staz_stream_online_fn, &ctx);
+
+    const int err = errno;
+    free(ctx.scratch);
+    errno = err;
+    return acc;
+}
+
+/* --- COVARIANCE MATRICES --- */
+
+/** Rows packed per step by the Gram matrix kernel */
+#ifndef STAZ_SYRK_ROWS
+#define STAZ_SYRK_ROWS 256
+#endif
+
+/**
+ * @brief Column means of the n x (px + (y != NULL)) matrix [x y]
+ * 
+ * @note Sums are accumulated per block of STAZ_SYRK_ROWS rows, then added,
+ *       which keeps the rounding error of long columns small.
+ */
+static void
+_staz_column_means(const double* x, size_t n, size_t px, const double* y, double* means) {
+    const size_t p = px + (y != NULL);
+    double* block = means + p; // caller provides 2 * p doubles
+
+    for (size_t j = 0; j < p; j++) means[j] = 0.0;
+
+    for (size_t r0 = 0; r0 < n; r0 += STAZ_SYRK_ROWS) {
+        const size_t end = (n - r0 < STAZ_SYRK_ROWS) ? n : r0 + STAZ_SYRK_ROWS;
+
+        for (size_t j = 0; j < p; j++) block[j] = 0.0;
+
+        for (size_t r = r0; r < end; r++) {
+            const double* row = x + r * px;
+            for (size_t j = 0; j < px; j++) block[j] += row[j];
+            if (y) block[px] += y[r];
+        }
+
+        for (size_t j = 0; j < p; j++) means[j] += block[j];
+    }
+
+    for (size_t j = 0; j < p; j++) means[j] /= n;
+}
+
+/**
+ * @brief 4x4 micro-kernel: acc[4a + b] = sum over r of pi[4r + a] * pj[4r + b]
+ */
+static inline void
+_staz_syrk_4x4(const double* pi, const double* pj, size_t rows, double* acc) {
+#if defined(__AVX__)
+    #if defined(__FMA__)
+        #define STAZ_MADD256(a, b, c) _mm256_fmadd_pd((a), (b), (c))
+    #else
+        #define STAZ_MADD256(a, b, c) _mm256_add_pd(_mm256_mul_pd((a), (b)), (c))
+    #endif
+
+    __m256d c0 = _mm256_setzero_pd(), c1 = _mm256_setzero_pd();
+    __m256d c2 = _mm256_setzero_pd(), c3 = _mm256_setzero_pd();
+
+    for (size_t r = 0; r < rows; r++) {
+        const __m256d b = _mm256_loadu_pd(pj + 4 * r);
+
+        c0 = STAZ_MADD256(_mm256_broadcast_sd(pi + 4 * r), b, c0);
+        c1 = STAZ_MADD256(_mm256_broadcast_sd(pi + 4 * r + 1), b, c1);
+        c2 = STAZ_MADD256(_mm256_broadcast_sd(pi + 4 * r + 2), b, c2);
+        c3 = STAZ_MADD256(_mm256_broadcast_sd(pi + 4 * r + 3), b, c3);
+    }
+
+    _mm256_storeu_pd(acc, c0);
+    _mm256_storeu_pd(acc + 4, c1);
+    _mm256_storeu_pd(acc + 8, c2);
+    _mm256_storeu_pd(acc + 12, c3);
+
+    #undef STAZ_MADD256
+#else
+    for (size_t k = 0; k < 16; k++) acc[k] = 0.0;
+
+    for (size_t r = 0; r < rows; r++) {
+        const double* a = pi + 4 * r;
+        const double* b = pj + 4 * r;
+
+        for (size_t i = 0; i < 4; i++) {
+            for (size_t j = 0; j < 4; j++) acc[4 * i + j] += a[i] * b[j];
+        }
+    }
+#endif
+}
+
+/**
+ * @brief Doubles of workspace _staz_syrk needs for p columns (panels, then column sums)
+ */
+static inline size_t
+_staz_syrk_work(size_t p) {
+    return (p + 3) / 4 * (STAZ_SYRK_ROWS * 4 + 4);
+}
+
+/**
+ * @brief Scatter (Gram) matrix of the columns of [x y]
+ * 
+ * @param x Row-major n x px matrix
+ * @param n Number of rows
+ * @param px Number of columns of x
+ * @param y Optional extra column of n values, NULL if none
+ * @param shift Column centers (p values), NULL for the uncentered Gram matrix
+ * @param out Output p x p matrix, p = px + (y != NULL)
+ * @param work Workspace of _staz_syrk_work(p) doubles, NULL to allocate it
+ * 
+ * @return int 1 on success, 0 if memory allocation fails
+ * 
+ * @note With shift, out is the sum of outer products of the rows minus
+ *       their column mean (shift should be the means computed beforehand:
+ *       the remaining offset is corrected exactly as in the corrected
+ *       two-pass algorithm). Without shift, out is [x y]' [x y].
+ * 
+ *       Rows are processed in blocks of STAZ_SYRK_ROWS: each block is
+ *       transposed (and centered) into panels of 4 columns, then every
+ *       pair of panels i <= j is multiplied by a 4x4 register-blocked
+ *       micro-kernel, in parallel over panel pairs. Only the upper
+ *       triangle is computed; it is mirrored at the end.
+ */
+static int
+_staz_syrk(const double* x, size_t n, size_t px, const double* y, const double* shift, double* out, double* work) {
+    const size_t p = px + (y != NULL);
+    const size_t groups = (p + 3) / 4;
+    const size_t rows = STAZ_SYRK_ROWS;
+
+    double* owned = NULL;
+    if (!work) {
+        owned = (double *)malloc(_staz_syrk_work(p) * sizeof(double));
+        if (!owned) return 0;
+        work = owned;
+    }
+
+    double* panels = work;
+    double* colsum = panels + groups * rows * 4;
+
+    for (size_t k = 0; k < groups * 4; k++) colsum[k] = 0.0;
+    for (size_t k = 0; k < p * p; k++) out[k] = 0.0;
+
+    STAZ_OMP(omp parallel if ((double)n * p * p >= 1e7))
+    {
+        for (size_t r0 = 0; r0 < n; r0 += rows) {
+            const size_t m = (n - r0 < rows) ? n - r0 : rows;
+
+            // Transpose and center the row block into panels of 4 columns
+            STAZ_OMP(omp for schedule(static))
+            for (size_t g = 0; g < groups; g++) {
+                double* panel = panels + g * rows * 4;
+
+                for (size_t r = 0; r < m; r++) {
+                    for (size_t k = 0; k < 4; k++) {
+                        const size_t col = 4 * g + k;
+                        double v = 0.0;
+
+                        if (col < px) {
+                            v = x[(r0 + r) * px + col];
+                        } else if (col < p) {
+                            v = y[r0 + r];
+                        }
+
+                        if (shift && col < p) {
+                            v -= shift[col];
+                            colsum[col] += v;
+                        }
+
+                        panel[4 * r + k] = v;
+                    }
+                }
+            }
+
+            // Multiply every pair of panels of the upper triangle
+            STAZ_OMP(omp for schedule(dynamic, 1))
+            for (size_t gi = 0; gi < groups; gi++) {
+                for (size_t gj = gi; gj < groups; gj++) {
+                    double acc[16];
+                    _staz_syrk_4x4(panels + gi * rows * 4, panels + gj * rows * 4, m, acc);
+
+                    for (size_t a = 0; a < 4 && 4 * gi + a < p; a++) {
+                        double* dst = out + (4 * gi + a) * p + 4 * gj;
+                        for (size_t b = 0; b < 4 && 4 * gj + b < p; b++) dst[b] += acc[4 * a + b];
+                    }
+                }
+            }
+        }
+    }
+
+    for (size_t i = 0; i < p; i++) {
+        for (size_t j = i; j < p; j++) {
+            if (shift) out[i * p + j] -= colsum[i] * colsum[j] / n;
+            out[j * p + i] = out[i * p + j];
+        }
+    }
+
+    free(owned);
+    return 1;
+}
+
+/**
+ * @brief Calculates the covariance matrix of the columns of a matrix
+ * 
+ * @param data Row-major n x p matrix (one observation per row), left unchanged
+ * @param n Number of rows
+ * @param p Number of columns
+ * @param out Output p x p row-major matrix, set to NAN on error
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if data or out is NULL, n or p is 0
+ *       - MEMORY_ALLOCATION_ERROR if memory allocation fails
+ *       - NAN_ERROR if a column mean is NAN (only the entries of that column are NAN)
+ *       - 0 if operation succeeds
+ *       - This calculates population covariance (dividing by n, not n-1)
+ * 
+ * @note All p * (p + 1) / 2 covariances come from one blocked pass over
+ *       the data after the column means, instead of one call per pair.
+ */
+void
+staz_covariance_matrix(const double* data, size_t n, size_t p, double* out) {
+    if (!data || !out || n == 0 || p == 0) {
+        if (out) {
+            for (size_t k = 0; k < p * p; k++) out[k] = NAN;
+        }
+        errno = INVALID_PARAMETERS_ERROR;
+        return;
+    }
+
+    // Column means (and their helper row), then the workspace of the kernel
+    double* means = (double *)malloc((2 * p + _staz_syrk_work(p)) * sizeof(double));
+    if (!means) {
+        for (size_t k = 0; k < p * p; k++) out[k] = NAN;
+        errno = MEMORY_ALLOCATION_ERROR;
+        return;
+    }
+
+    _staz_column_means(data, n, p, NULL, means);
+    _staz_syrk(data, n, p, NULL, means, out, means + 2 * p);
+
+    errno = 0;
+    for (size_t j = 0; j < p; j++) {
+        if (isnan(means[j])) errno = NAN_ERROR;
+    }
+
+    for (size_t k = 0; k < p * p; k++) out[k] /= n;
+
+    free(means);
+}
+
+/**
+ * @brief Turns a covariance matrix into a correlation matrix in place
+ * 
+ * @return int 1 if every column has a non-zero variance, 0 otherwise (its entries are NAN)
+ */
+static int
+_staz_cov_to_corr(double* c, size_t p) {
+    int ok = 1;
+
+    // The diagonal temporarily holds 1 / sd of each column
+    for (size_t j = 0; j < p; j++) {
+        const double var = c[j * p + j];
+
+        if (!(var > 0.0)) ok = 0;
+        c[j * p + j] = (var > 0.0) ? 1.0 / sqrt(var) : NAN;
+    }
+
+    for (size_t i = 0; i < p; i++) {
+        for (size_t j = 0; j < p; j++) {
+            if (i != j) c[i * p + j] *= c[i * p + i] * c[j * p + j];
+        }
+    }
+
+    for (size_t j = 0; j < p; j++) c[j * p + j] = isnan(c[j * p + j]) ? NAN : 1.0;
+
+    return ok;
+}
+
+/**
+ * @brief Calculates the Pearson correlation matrix of the columns of a matrix
+ * 
+ * @param data Row-major n x p matrix (one observation per row), left unchanged
+ * @param n Number of rows
+ * @param p Number of columns
+ * @param out Output p x p row-major matrix, set to NAN on error
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if data or out is NULL, n or p is 0
+ *       - MEMORY_ALLOCATION_ERROR if memory allocation fails
+ *       - NAN_ERROR if a column mean is NAN
+ *       - ZERO_DIVISION_ERROR if a column is constant (its entries are NAN)
+ *       - 0 if operation succeeds
+ */
+void
+staz_correlation_matrix(const double* data, size_t n, size_t p, double* out) {
+    staz_covariance_matrix(data, n, p, out);
+    if (errno == INVALID_PARAMETERS_ERROR || errno == MEMORY_ALLOCATION_ERROR) return;
+
+    const int err = errno;
+    if (!_staz_cov_to_corr(out, p) && err == 0) {
+        errno = ZERO_DIVISION_ERROR;
+    } else {
+        errno = err;
+    }
+}
+
+/* --- CO-MOMENT ACCUMULATOR --- */
+
+/** Batches smaller than this are folded in one row at a time */
+#ifndef STAZ_COMOMENT_BLOCK_MIN
+#define STAZ_COMOMENT_BLOCK_MIN 8
+#endif
+
+/**
+ * @brief Running means and co-moment matrix of a stream of p-variate rows
+ * 
+ * Batches of rows are reduced with the blocked Gram kernel of
+ * staz_covariance_matrix() and folded in with Chan's parallel update, so
+ * the covariance of everything seen is available at any time without
+ * keeping the rows.
+ */
+typedef struct {
+    size_t p;        /** Number of variables */
+    size_t n;        /** Number of rows seen */
+    double* mean;    /** Column means (p values) */
+    double* m2;      /** Sum of (x - mean)(x - mean)' over the rows (p x p, row-major) */
+    double* scratch; /** Workspace of one batch (co-moments, means and the Gram kernel's panels) */
+} staz_comoment;
+
+/**
+ * @brief Creates an empty co-moment accumulator
+ * 
+ * @param p Number of variables
+ * 
+ * @return staz_comoment The accumulator; every field is zero on error
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if p is 0
+ *       - MEMORY_ALLOCATION_ERROR if memory allocation fails
+ *       - 0 if operation succeeds
+ */
+staz_comoment
+staz_comoment_create(size_t p) {
+    staz_comoment acc;
+    memset(&acc, 0, sizeof(acc));
+
+    if (p == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return acc;
+    }
+
+    double* block = (double *)calloc(2 * p * p + 4 * p + _staz_syrk_work(p), sizeof(double));
+    if (!block) {
+        errno = MEMORY_ALLOCATION_ERROR;
+        return acc;
+    }
+
+    acc.p = p;
+    acc.mean = block;
+    acc.m2 = block + p;
+    acc.scratch = block + p + p * p;
+
+    errno = 0;
+    return acc;
+}
+
+/**
+ * @brief Releases the memory held by a co-moment accumulator
+ */
+void
+staz_comoment_destroy(staz_comoment* acc) {
+    if (!acc) return;
+
+    free(acc->mean);
+    memset(acc, 0, sizeof(*acc));
+}
+
+/**
+ * @brief Folds nb rows with means mb and co-moments mb2 into acc (Chan et al.)
+ */
+static void
+_staz_comoment_fold(staz_comoment* acc, size_t nb, const double* mb, const double* mb2) {
+    const size_t p = acc->p;
+
+    if (nb == 0) return;
+
+    if (acc->n == 0) {
+        memcpy(acc->mean, mb, p * sizeof(double));
+        memcpy(acc->m2, mb2, p * p * sizeof(double));
+        acc->n = nb;
+        return;
+    }
+
+    const size_t total = acc->n + nb;
+    const double f = (double)acc->n * nb / total;
+    double* delta = acc->scratch + p * p + 2 * p;
+
+    for (size_t j = 0; j < p; j++) delta[j] = mb[j] - acc->mean[j];
+
+    for (size_t i = 0; i < p; i++) {
+        const double fi = f * delta[i];
+        double* row = acc->m2 + i * p;
+        const double* brow = mb2 + i * p;
+
+        for (size_t j = 0; j < p; j++) row[j] += brow[j] + fi * delta[j];
+    }
+
+    for (size_t j = 0; j < p; j++) acc->mean[j] += delta[j] * nb / total;
+    acc->n = total;
+}
+
+/**
+ * @brief Adds a batch of rows to a co-moment accumulator
+ * 
+ * @param acc Pointer to the accumulator
+ * @param rows Row-major count x p matrix
+ * @param count Number of rows
+ * 
+ * @note Batches of at least STAZ_COMOMENT_BLOCK_MIN rows are reduced as a
+ *       block (rank-count update through the blocked Gram kernel); smaller
+ *       ones apply one rank-1 update per row. Every buffer is part of the
+ *       accumulator, so updates never allocate.
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if acc is not initialized or rows is NULL with count > 0
+ *       - 0 if operation succeeds
+ */
+void
+staz_comoment_update(staz_comoment* acc, const double* rows, size_t count) {
+    if (!acc || !acc->mean || (!rows && count > 0)) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return;
+    }
+
+    const size_t p = acc->p;
+
+    if (count < STAZ_COMOMENT_BLOCK_MIN) {
+        double* delta = acc->scratch;
+
+        for (size_t r = 0; r < count; r++) {
+            const double* x = rows + r * p;
+            const size_t total = acc->n + 1;
+            const double f = (double)acc->n / total;
+
+            for (size_t j = 0; j < p; j++) {
+                delta[j] = x[j] - acc->mean[j];
+                acc->mean[j] += delta[j] / total;
+            }
+
+            for (size_t i = 0; i < p; i++) {
+                const double fi = f * delta[i];
+                double* row = acc->m2 + i * p;
+
+                for (size_t j = 0; j < p; j++) row[j] += fi * delta[j];
+            }
+
+            acc->n = total;
+        }
+
+        errno = 0;
+        return;
+    }
+
+    // Batch co-moments in scratch, batch means (and their helper row) after
+    // them, then the fold's delta row and the workspace of the Gram kernel
+    double* means = acc->scratch + p * p;
+
+    _staz_column_means(rows, count, p, NULL, means);
+    _staz_syrk(rows, count, p, NULL, means, acc->scratch, means + 3 * p);
+
+    _staz_comoment_fold(acc, count, means, acc->scratch);
+    errno = 0;
+}
+
+/**
+ * @brief Folds another accumulator over the same variables into acc
+ * 
+ * @param acc Pointer to the accumulator to update
+ * @param other Pointer to the accumulator to fold in (e.g. from another shard)
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if either accumulator is not initialized or p differs
+ *       - 0 if operation succeeds
+ */
+void
+staz_comoment_merge(staz_comoment* acc, const staz_comoment* other) {
+    if (!acc || !other || !acc->mean || !other->mean || acc->p != other->p) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return;
+    }
+
+    _staz_comoment_fold(acc, other->n, other->mean, other->m2);
+    errno = 0;
+}
+
+/**
+ * @brief Mean of variable j, NAN (INVALID_PARAMETERS_ERROR) if no row was seen or j is out of range
+ */
+double
+staz_comoment_mean(const staz_comoment* acc, size_t j) {
+    if (!acc || acc->n == 0 || j >= acc->p) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    errno = 0;
+    return acc->mean[j];
+}
+
+/**
+ * @brief Population variance of variable j, NAN (INVALID_PARAMETERS_ERROR) if no row was seen or j is out of range
+ */
+double
+staz_comoment_variance(const staz_comoment* acc, size_t j) {
+    if (!acc || acc->n == 0 || j >= acc->p) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    errno = 0;
+    return acc->m2[j * acc->p + j] / acc->n;
+}
+
+/**
+ * @brief Population covariance matrix of the rows seen so far
+ * 
+ * @param acc Pointer to the accumulator
+ * @param out Output p x p row-major matrix, set to NAN on error
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if acc is not initialized, out is NULL or no row was seen
+ *       - 0 if operation succeeds
+ */
+void
+staz_comoment_covariance(const staz_comoment* acc, double* out) {
+    if (!acc || !acc->mean || !out || acc->n == 0) {
+        if (acc && out) {
+            for (size_t k = 0; k < acc->p * acc->p; k++) out[k] = NAN;
+        }
+        errno = INVALID_PARAMETERS_ERROR;
+        return;
+    }
+
+    for (size_t k = 0; k < acc->p * acc->p; k++) out[k] = acc->m2[k] / acc->n;
+    errno = 0;
+}
+
+/**
+ * @brief Pearson correlation matrix of the rows seen so far
+ * 
+ * @param acc Pointer to the accumulator
+ * @param out Output p x p row-major matrix, set to NAN on error
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if acc is not initialized, out is NULL or no row was seen
+ *       - ZERO_DIVISION_ERROR if a variable is constant (its entries are NAN)
+ *       - 0 if operation succeeds
+ */
+void
+staz_comoment_correlation(const staz_comoment* acc, double* out) {
+    staz_comoment_covariance(acc, out);
+    if (errno) return;
+
+    if (!_staz_cov_to_corr(out, acc->p)) errno = ZERO_DIVISION_ERROR;
+}
+
+/* --- RANK CORRELATION --- */
+
+/**
+ * @brief Finds the number of elements of a sorted array less than or equal to x
+ */
+static inline size_t
+_staz_upper_bound(const double* sorted, size_t len, double x) {
+    size_t lo = 0;
+
+    while (len > 0) {
+        const size_t half = len / 2;
+
+        if (sorted[lo + half] <= x) {
+            lo += half + 1;
+            len -= half + 1;
+        } else {
+            len = half;
+        }
+    }
+
+    return lo;
+}
+
+/** Arrays up to this length are ranked by binary search in a sorted copy */
+#ifndef STAZ_RANK_SEARCH_MAX
+#define STAZ_RANK_SEARCH_MAX (1u << 14)
+#endif
+
+/**
+ * @brief LSD radix argsort of 64-bit keys
+ * 
+ * @param keys Keys, then scratch
+ * @param tmp Scratch area of len keys
+ * @param idx Payload moved along with the keys (e.g. 0 .. len-1), then scratch
+ * @param itmp Scratch area of len payloads
+ * @param hist Scratch area of STAZ_RADIX_PASSES * STAZ_RADIX_BUCKETS counters
+ * @param len Number of keys
+ * @param order Receives the buffer holding the sorted payloads
+ * 
+ * @return uint64_t* The buffer holding the sorted keys (keys or tmp)
+ * 
+ * @note Same digits and pass skipping as _staz_radix_sort_u64; the sort is
+ *       stable, so equal keys keep their index order.
+ */
+static uint64_t*
+_staz_radix_argsort_u64(uint64_t* keys, uint64_t* tmp, size_t* idx, size_t* itmp,
+                        size_t* hist, size_t len, size_t** order) {
+    const uint64_t mask = STAZ_RADIX_BUCKETS - 1;
+
+    memset(hist, 0, STAZ_RADIX_PASSES * STAZ_RADIX_BUCKETS * sizeof(size_t));
+
+    for (size_t i = 0; i < len; i++) {
+        const uint64_t k = keys[i];
+
+        for (unsigned p = 0; p < STAZ_RADIX_PASSES; p++) {
+            hist[p * STAZ_RADIX_BUCKETS + ((k >> (p * STAZ_RADIX_BITS)) & mask)]++;
+        }
+    }
+
+    uint64_t* src = keys;
+    uint64_t* dst = tmp;
+    size_t* isrc = idx;
+    size_t* idst = itmp;
+
+    for (unsigned p = 0; p < STAZ_RADIX_PASSES; p++) {
+        const unsigned shift = p * STAZ_RADIX_BITS;
+        size_t* off = hist + p * STAZ_RADIX_BUCKETS;
+
+        if (off[(src[0] >> shift) & mask] == len) continue;
+
+        size_t total = 0;
+        for (size_t d = 0; d < STAZ_RADIX_BUCKETS; d++) {
+            const size_t c = off[d];
+            off[d] = total;
+            total += c;
+        }
+
+        for (size_t i = 0; i < len; i++) {
+            const uint64_t k = src[i];
+            const size_t at = off[(k >> shift) & mask]++;
+
+            dst[at] = k;
+            idst[at] = isrc[i];
+        }
+
+        uint64_t* t = src;
+        src = dst;
+        dst = t;
+
+        size_t* it = isrc;
+        isrc = idst;
+        idst = it;
+    }
+
+    *order = isrc;
+    return src;
+}
+
+/**
+ * @brief Fractional ranks (1-based, ties averaged) of the values of an array
+ * 
+ * @param nums Values, left unchanged
+ * @param len Number of values
+ * @param ranks Output ranks; NAN values get a NAN rank
+ * @param parallel 0 when called from a parallel region, to keep it single-threaded
+ * 
+ * @return int 1 on success, 0 if memory allocation fails
+ * 
+ * @note Small arrays are ranked in parallel by binary search (lower and
+ *       upper bound) in a sorted copy, which stays in cache. Larger ones
+ *       are argsorted: order-preserving integer keys are radix sorted
+ *       together with their indices, then each run of ties is given its
+ *       average rank in one sequential scan and scattered back (serially).
+ */
+static int
+_staz_rank(const double* nums, size_t len, double* ranks, int parallel) {
+    (void)parallel; // only read by the OpenMP pragma below
+
+    if (len <= STAZ_RANK_SEARCH_MAX) {
+        double* sorted = (double *)malloc(len * sizeof(double));
+        if (!sorted) return 0;
+
+        memcpy(sorted, nums, len * sizeof(double));
+        _staz_sort(sorted, len);
+
+        size_t m = len;
+        while (m > 0 && isnan(sorted[m - 1])) m--;
+
+        STAZ_OMP(omp parallel for schedule(static) if (parallel && len >= 4096))
+        for (size_t i = 0; i < len; i++) {
+            const double x = nums[i];
+
+            if (isnan(x)) {
+                ranks[i] = NAN;
+            } else {
+                const size_t lo = _staz_lower_bound(sorted, m, x);
+                const size_t hi = _staz_upper_bound(sorted + lo, m - lo, x) + lo;
+
+                ranks[i] = 0.5 * (double)(lo + 1 + hi);
+            }
+        }
+
+        free(sorted);
+        return 1;
+    }
+
+    // Keys, indices, their ping-pong buffers and histograms share one allocation
+    uint64_t* keys = (uint64_t *)malloc(2 * len * sizeof(uint64_t) + 2 * len * sizeof(size_t)
+                                        + STAZ_RADIX_PASSES * STAZ_RADIX_BUCKETS * sizeof(size_t));
+    if (!keys) return 0;
+
+    uint64_t* tmp = keys + len;
+    size_t* idx = (size_t *)(tmp + len);
+    size_t* itmp = idx + len;
+    size_t* hist = itmp + len;
+
+    // NANs get the largest key, so they end up last
+    for (size_t i = 0; i < len; i++) {
+        keys[i] = isnan(nums[i]) ? UINT64_MAX : _staz_double_to_key(nums[i]);
+        idx[i] = i;
+    }
+
+    size_t* order;
+    const uint64_t* sorted = _staz_radix_argsort_u64(keys, tmp, idx, itmp, hist, len, &order);
+
+    for (size_t i = 0; i < len; ) {
+        if (sorted[i] == UINT64_MAX) {
+            for (; i < len; i++) ranks[order[i]] = NAN;
+            break;
+        }
+
+        // Runs of equal values (-0 and +0 included) share the average rank
+        const double x = _staz_key_to_double(sorted[i]);
+        size_t j = i + 1;
+        while (j < len && sorted[j] != UINT64_MAX && _staz_key_to_double(sorted[j]) == x) j++;
+
+        const double rank = 0.5 * (double)(i + 1 + j);
+        for (; i < j; i++) ranks[order[i]] = rank;
+    }
+
+    free(keys);
+    return 1;
+}
+
+/**
+ * @brief Calculates the fractional ranks of the values of an array
+ * 
+ * @param nums Pointer to the array of double values, left unchanged
+ * @param len Length of the array
+ * @param ranks Output array of len ranks (1 for the smallest value, ties
+ *        get the average of the ranks they span, NAN values get NAN)
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if nums or ranks is NULL or len is 0
+ *       - MEMORY_ALLOCATION_ERROR if memory allocation fails
+ *       - 0 if operation succeeds
+ */
+void
+staz_rank(const double* nums, size_t len, double* ranks) {
+    if (!nums || !ranks || len == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return;
+    }
+
+    if (!_staz_rank(nums, len, ranks, 1)) {
+        errno = MEMORY_ALLOCATION_ERROR;
+        return;
+    }
+
+    errno = 0;
+}
+
+/**
+ * @brief Calculates the Spearman rank correlation coefficient between two arrays
+ * 
+ * @param x Pointer to the first array of double values, left unchanged
+ * @param y Pointer to the second array of double values, left unchanged
+ * @param len Length of both arrays
+ * 
+ * @return double The Pearson correlation of the ranks of x and y, ties averaged
+ *         NAN on error
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if either array is NULL or len is 0
+ *       - MEMORY_ALLOCATION_ERROR if memory allocation fails
+ *       - NAN_ERROR if either array contains NAN
+ *       - ZERO_DIVISION_ERROR if either array is constant
+ *       - 0 if operation succeeds
+ */
+double
+staz_spearman(const double* x, const double* y, size_t len) {
+    if (!x || !y || len == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    double* rx = (double *)malloc(2 * len * sizeof(double));
+    if (!rx) {
+        errno = MEMORY_ALLOCATION_ERROR;
+        return NAN;
+    }
+
+    double* ry = rx + len;
+
+    if (!_staz_rank(x, len, rx, 1) || !_staz_rank(y, len, ry, 1)) {
+        free(rx);
+        errno = MEMORY_ALLOCATION_ERROR;
+        return NAN;
+    }
+
+    // Both rank vectors average (len + 1) / 2 unless there are NANs
+    const double mean = 0.5 * (double)(len + 1);
+    double sxx = 0.0, syy = 0.0, sxy = 0.0;
+
+    for (size_t i = 0; i < len; i++) {
+        const double dx = rx[i] - mean;
+        const double dy = ry[i] - mean;
+
+        sxx += dx * dx;
+        syy += dy * dy;
+        sxy += dx * dy;
+    }
+
+    free(rx);
+
+    if (isnan(sxy)) {
+        errno = NAN_ERROR;
+        return NAN;
+    }
+
+    if (sxx == 0.0 || syy == 0.0) {
+        errno = ZERO_DIVISION_ERROR;
+        return NAN;
+    }
+
+    errno = 0;
+    return sxy / sqrt(sxx * syy);
+}
+
+/**
+ * @brief Calculates the Spearman rank correlation matrix of the columns of a matrix
+ * 
+ * @param data Row-major n x p matrix (one observation per row), left unchanged
+ * @param n Number of rows
+ * @param p Number of columns
+ * @param out Output p x p row-major matrix, set to NAN on error
+ * 
+ * @note Each column is ranked once, then the ranks go through the blocked
+ *       kernel of staz_correlation_matrix(). From STAZ_PARALLEL_THRESHOLD
+ *       values up, columns are ranked in parallel, one column per thread
+ *       at a time, each thread with its own scratch column.
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if data or out is NULL, n or p is 0
+ *       - MEMORY_ALLOCATION_ERROR if memory allocation fails
+ *       - NAN_ERROR if a column contains NAN
+ *       - ZERO_DIVISION_ERROR if a column is constant (its entries are NAN)
+ *       - 0 if operation succeeds
+ */
+void
+staz_spearman_matrix(const double* data, size_t n, size_t p, double* out) {
+    if (!data || !out || n == 0 || p == 0) {
+        if (out) {
+            for (size_t k = 0; k < p * p; k++) out[k] = NAN;
+        }
+        errno = INVALID_PARAMETERS_ERROR;
+        return;
+    }
+
+    size_t threads = _staz_num_threads();
+    if (threads > p) threads = p;
+    if ((double)n * p < STAZ_PARALLEL_THRESHOLD) threads = 1;
+
+    // One column of values and one of ranks per thread
+    double* ranked = (double *)malloc(n * p * sizeof(double));
+    double* scratch = (double *)malloc(threads * 2 * n * sizeof(double));
+
+    int failed = !ranked || !scratch;
+
+    if (!failed) {
+        STAZ_OMP(omp parallel for schedule(static, 1) num_threads(threads) reduction(+:failed) if (threads > 1))
+        for (size_t t = 0; t < threads; t++) {
+            double* column = scratch + t * 2 * n;
+
+            for (size_t j = t; j < p; j += threads) {
+                for (size_t r = 0; r < n; r++) column[r] = data[r * p + j];
+
+                if (!_staz_rank(column, n, column + n, threads == 1)) {
+                    failed++;
+                    break;
+                }
+
+                for (size_t r = 0; r < n; r++) ranked[r * p + j] = column[n + r];
+            }
+        }
+    }
+
+    free(scratch);
+
+    if (failed) {
+        free(ranked);
+        for (size_t k = 0; k < p * p; k++) out[k] = NAN;
+        errno = MEMORY_ALLOCATION_ERROR;
+        return;
+    }
+
+    staz_correlation_matrix(ranked, n, p, out);
+
+    free(ranked);
+}
+
+/* --- KENDALL TAU --- */
+
+/**
+ * @brief Sorts a short run by insertion, counting inversions
+ */
+static uint64_t
+_staz_insertion_count(uint32_t* v, size_t len) {
+    uint64_t swaps = 0;
+
+    for (size_t i = 1; i < len; i++) {
+        const uint32_t x = v[i];
+        size_t j = i;
+
+        for (; j > 0 && v[j - 1] > x; j--) v[j] = v[j - 1];
+
+        swaps += i - j;
+        v[j] = x;
+    }
+
+    return swaps;
+}
+
+/**
+ * @brief Merges two sorted runs, counting the pairs out of order across them
+ */
+static uint64_t
+_staz_merge_count(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out) {
+    uint64_t swaps = 0;
+    size_t i = 0, j = 0, k = 0;
+
+    while (i < na && j < nb) {
+        if (b[j] < a[i]) {
+            swaps += na - i;
+            out[k++] = b[j++];
+        } else {
+            out[k++] = a[i++];
+        }
+    }
+
+    while (i < na) out[k++] = a[i++];
+    while (j < nb) out[k++] = b[j++];
+
+    return swaps;
+}
+
+/**
+ * @brief Sorts v, returning the number of pairs i < j with v[i] > v[j]
+ * 
+ * @param v Values to sort
+ * @param tmp Scratch area of len values
+ * @param len Number of values
+ * 
+ * @note Bottom-up merge sort over runs presorted by insertion sort. The
+ *       merges of each level are independent and run in parallel.
+ *       Returns with the sorted values in v.
+ */
+static uint64_t
+_staz_count_inversions(uint32_t* v, uint32_t* tmp, size_t len) {
+    const size_t run = 32;
+    uint64_t swaps = 0;
+
+    STAZ_OMP(omp parallel for schedule(static) reduction(+:swaps) if (len >= 1u << 16))
+    for (size_t s = 0; s < len; s += run) {
+        swaps += _staz_insertion_count(v + s, (len - s < run) ? len - s : run);
+    }
+
+    uint32_t* src = v;
+    uint32_t* dst = tmp;
+
+    for (size_t width = run; width < len; width *= 2) {
+        STAZ_OMP(omp parallel for schedule(dynamic, 1) reduction(+:swaps) if (len >= 1u << 16))
+        for (size_t s = 0; s < len; s += 2 * width) {
+            const size_t mid = (len - s < width) ? len : s + width;
+            const size_t end = (len - s < 2 * width) ? len : s + 2 * width;
+
+            swaps += _staz_merge_count(src + s, mid - s, src + mid, end - mid, dst + s);
+        }
+
+        uint32_t* t = src;
+        src = dst;
+        dst = t;
+    }
+
+    if (src != v) memcpy(v, src, len * sizeof(uint32_t));
+
+    return swaps;
+}
+
+/**
+ * @brief Calculates Kendall's tau-b rank correlation between two arrays
+ * 
+ * @param x Pointer to the first array of double values, left unchanged
+ * @param y Pointer to the second array of double values, left unchanged
+ * @param len Length of both arrays (at least 2)
+ * 
+ * @return double Tau-b, which accounts for ties in either array
+ *         NAN on error
+ * 
+ * @note Knight's O(n log n) algorithm: the pairs are sorted by x then y
+ *       (their ranks packed into one 64-bit key for the radix sort), and
+ *       discordant pairs are the swaps of a merge sort of the y sequence.
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if either array is NULL or len is below 2
+ *       - MEMORY_ALLOCATION_ERROR if memory allocation fails
+ *       - NAN_ERROR if either array contains NAN
+ *       - ZERO_DIVISION_ERROR if either array is constant
+ *       - 0 if operation succeeds
+ */
+double
+staz_kendall_tau(const double* x, const double* y, size_t len) {
+    if (!x || !y || len < 2 || len > UINT32_MAX / 2) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        if (isnan(x[i]) || isnan(y[i])) {
+            errno = NAN_ERROR;
+            return NAN;
+        }
+    }
+
+    // Ranks, then packed keys with their radix buffers, then the y sequence
+    double* ranks = (double *)malloc(2 * len * sizeof(double));
+    uint64_t* keys = (uint64_t *)malloc(2 * len * sizeof(uint64_t)
+                                        + STAZ_RADIX_PASSES * STAZ_RADIX_BUCKETS * sizeof(size_t));
+
+    if (!ranks || !keys || !_staz_rank(x, len, ranks, 1) || !_staz_rank(y, len, ranks + len, 1)) {
+        free(ranks);
+        free(keys);
+        errno = MEMORY_ALLOCATION_ERROR;
+        return NAN;
+    }
+
+    // Twice an averaged rank is an integer that preserves order and ties
+    for (size_t i = 0; i < len; i++) {
+        keys[i] = ((uint64_t)(2.0 * ranks[i]) << 32) | (uint64_t)(2.0 * ranks[len + i]);
+    }
+
+    free(ranks);
+
+    uint64_t* tmp = keys + len;
+    size_t* hist = (size_t *)(tmp + len);
+    const uint64_t* sorted = _staz_radix_sort_u64(keys, tmp, hist, len);
+
+    // Ties in x and joint ties, while copying the y sequence out
+    uint32_t* seq = (uint32_t *)((sorted == keys) ? tmp : keys);
+    double tx = 0.0, txy = 0.0;
+
+    for (size_t i = 0; i < len; ) {
+        size_t j = i + 1;
+        while (j < len && (sorted[j] >> 32) == (sorted[i] >> 32)) j++;
+        tx += 0.5 * (double)(j - i) * (double)(j - i - 1);
+
+        for (size_t a = i; a < j; ) {
+            size_t b = a + 1;
+            while (b < j && sorted[b] == sorted[a]) b++;
+            txy += 0.5 * (double)(b - a) * (double)(b - a - 1);
+            a = b;
+        }
+
+        i = j;
+    }
+
+    // The other half of the key buffers holds the sequence and its scratch
+    for (size_t i = 0; i < len; i++) seq[i] = (uint32_t)sorted[i];
+
+    const uint64_t swaps = _staz_count_inversions(seq, seq + len, len);
+
+    double ty = 0.0;
+    for (size_t i = 0; i < len; ) {
+        size_t j = i + 1;
+        while (j < len && seq[j] == seq[i]) j++;
+        ty += 0.5 * (double)(j - i) * (double)(j - i - 1);
+        i = j;
+    }
+
+    free(keys);
+
+    const double pairs = 0.5 * (double)len * (double)(len - 1);
+    const double denom = (pairs - tx) * (pairs - ty);
+
+    if (denom == 0.0) {
+        errno = ZERO_DIVISION_ERROR;
+        return NAN;
+    }
+
+    errno = 0;
+    return (pairs - tx - ty + txy - 2.0 * (double)swaps) / sqrt(denom);
+}
+
+/* --- BIVARIATE SUMMARY --- */
+
+/**
+ * @brief Simple linear regression of y on x with its fit statistics
+ */
+typedef struct {
+    double slope;        /** Slope of the fitted line */
+    double intercept;    /** Intercept of the fitted line */
+    double r;            /** Pearson correlation coefficient */
+    double r2;           /** Coefficient of determination */
+    double se_slope;     /** Standard error of the slope */
+    double se_intercept; /** Standard error of the intercept */
+    double residual_se;  /** Residual standard error, sqrt(SSE / (n - 2)) */
+    size_t n;            /** Number of pairs */
+} staz_bivariate_info;
+
+/**
+ * @brief Sum of squared residuals of a fitted line, compensated (Neumaier)
+ * 
+ * @note Residuals are formed from centered values, which removes the
+ *       cancellation between y and the intercept on offset data.
+ */
+static double
+_staz_residual_ss(const double* x, const double* y, size_t len, const _staz_moments2* m, double slope) {
+    double sum = 0.0, comp = 0.0;
+
+    STAZ_OMP(omp parallel for schedule(static) reduction(+:sum, comp) if (len >= STAZ_PARALLEL_THRESHOLD))
+    for (size_t i = 0; i < len; i++) {
+        const double e = (y[i] - m->mean_y) - slope * (x[i] - m->mean_x);
+        const double term = e * e;
+        const double t = sum + term;
+
+        comp += (fabs(sum) >= term) ? (sum - t) + term : (term - t) + sum;
+        sum = t;
+    }
+
+    return sum + comp;
+}
+
+/**
+ * @brief Fits y = slope * x + intercept and reports correlation and standard errors
+ * 
+ * @param x Pointer to the array of x coordinates
+ * @param y Pointer to the array of y coordinates
+ * @param len Length of both arrays (at least 3)
+ * @param residual_pass Nonzero to take the residual sum of squares from a
+ *        second, compensated pass over the residuals instead of from the
+ *        co-moments (SYY - slope * SXY), which loses digits on near-perfect fits
+ * 
+ * @return staz_bivariate_info Every statistic of the fit, all NAN on error
+ * 
+ * @note Everything comes from one read of x and y: blocked, stable
+ *       co-moments merged with Chan's update, parallelized with OpenMP.
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if x or y is NULL or len is below 3
+ *       - NAN_ERROR if x or y contains NAN
+ *       - ZERO_DIVISION_ERROR if x or y is constant
+ *       - 0 if operation succeeds
+ */
+staz_bivariate_info
+staz_bivariate_summary(const double* x, const double* y, size_t len, int residual_pass) {
+    staz_bivariate_info info = {NAN, NAN, NAN, NAN, NAN, NAN, NAN, 0};
+
+    if (!x || !y || len < 3) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return info;
+    }
+
+    const _staz_moments2 m = _staz_comoments2(x, y, len);
+
+    if (isnan(m.sxx + m.syy + m.sxy)) {
+        errno = NAN_ERROR;
+        return info;
+    }
+
+    if (m.sxx == 0 || m.syy == 0) {
+        errno = ZERO_DIVISION_ERROR;
+        return info;
+    }
+
+    const double n = (double)len;
+    const double slope = m.sxy / m.sxx;
+
+    double sse = residual_pass ? _staz_residual_ss(x, y, len, &m, slope) : m.syy - slope * m.sxy;
+    if (sse < 0) sse = 0;
+
+    info.slope = slope;
+    info.intercept = m.mean_y - slope * m.mean_x;
+    info.r = m.sxy / sqrt(m.sxx * m.syy);
+    if (info.r > 1.0) info.r = 1.0;
+    if (info.r < -1.0) info.r = -1.0;
+    info.r2 = 1.0 - sse / m.syy;
+    info.residual_se = sqrt(sse / (n - 2.0));
+    info.se_slope = info.residual_se / sqrt(m.sxx);
+    info.se_intercept = info.residual_se * sqrt(1.0 / n + m.mean_x * m.mean_x / m.sxx);
+    info.n = len;
+
+    errno = 0;
+    return info;
+}
+
+/* --- MULTIPLE REGRESSION --- */
+
+/** Smallest pivot accepted by the Cholesky factorization of a unit-diagonal matrix */
+#ifndef STAZ_CHOLESKY_TOL
+#define STAZ_CHOLESKY_TOL 1e-13
+#endif
+
+/**
+ * @brief In-place Cholesky factorization A = L L' of a symmetric matrix
+ * 
+ * @param a Row-major p x p matrix; its lower triangle is replaced by L
+ * @param p Order of the matrix
+ * @param tol Smallest pivot accepted
+ * 
+ * @return int 1 on success, 0 if A is not numerically positive definite
+ * 
+ * @note Left-looking by rows: every entry is a dot product of two rows of
+ *       L, which are contiguous. The rows below the pivot are independent
+ *       and computed in parallel for large p. Only the lower triangle is
+ *       read; the strict upper triangle is left untouched.
+ */
+static int
+_staz_cholesky(double* a, size_t p, double tol) {
+    for (size_t j = 0; j < p; j++) {
+        double* lj = a + j * p;
+        double d = lj[j];
+
+        for (size_t k = 0; k < j; k++) d -= lj[k] * lj[k];
+        if (!(d > tol)) return 0;
+
+        d = sqrt(d);
+        lj[j] = d;
+
+        STAZ_OMP(omp parallel for schedule(static) if ((p - j) * j >= 1u << 14))
+        for (size_t i = j + 1; i < p; i++) {
+            double* li = a + i * p;
+            double s = li[j];
+
+            for (size_t k = 0; k < j; k++) s -= li[k] * lj[k];
+            li[j] = s / d;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Solves L L' x = b in place, with L from _staz_cholesky
+ */
+static void
+_staz_cholesky_solve(const double* l, size_t p, double* b) {
+    for (size_t i = 0; i < p; i++) {
+        double s = b[i];
+        for (size_t k = 0; k < i; k++) s -= l[i * p + k] * b[k];
+        b[i] = s / l[i * p + i];
+    }
+
+    for (size_t i = p; i-- > 0; ) {
+        double s = b[i];
+        for (size_t k = i + 1; k < p; k++) s -= l[k * p + i] * b[k];
+        b[i] = s / l[i * p + i];
+    }
+}
+
+/**
+ * @brief Diagonal of (L L')^-1, with L from _staz_cholesky
+ * 
+ * @param l Cholesky factor (lower triangle of a p x p matrix)
+ * @param p Order of the matrix
+ * @param work Scratch area of p values
+ * @param diag Output p values
+ * 
+ * @note (L L')^-1 = L^-T L^-1, so its j-th diagonal entry is the squared
+ *       norm of the j-th column of L^-1, found by forward substitution.
+ */
+static void
+_staz_cholesky_inverse_diag(const double* l, size_t p, double* work, double* diag) {
+    for (size_t j = 0; j < p; j++) {
+        double norm = 0.0;
+
+        for (size_t i = j; i < p; i++) {
+            double s = (i == j) ? 1.0 : 0.0;
+            for (size_t k = j; k < i; k++) s -= l[i * p + k] * work[k];
+            work[i] = s / l[i * p + i];
+            norm += work[i] * work[i];
+        }
+
+        diag[j] = norm;
+    }
+}
+
+/**
+ * @brief Scales and factors the normal equations held in the Gram matrix of [X y]
+ * 
+ * @param gram Row-major (p + 1) x (p + 1) Gram matrix of [X y]
+ * @param p Number of predictors
+ * @param l Output p x p Cholesky factor of the scaled X'X (may be gram itself)
+ * @param scale Output p column norms sqrt(diag(X'X))
+ * @param rhs Output p values of the scaled X'y
+ * 
+ * @return int 1 on success, 0 if X'X is singular
+ * 
+ * @note X'X is scaled to a unit diagonal, which removes the conditioning
+ *       cost of badly scaled columns. The solution of l l' z = rhs gives
+ *       beta = z / scale. Rows are compacted in increasing order, so l may
+ *       overwrite gram.
+ */
+static int
+_staz_normal_factor(const double* gram, size_t p, double* l, double* scale, double* rhs) {
+    const size_t q = p + 1;
+
+    for (size_t j = 0; j < p; j++) {
+        scale[j] = sqrt(gram[j * q + j]);
+        if (!(scale[j] > 0)) return 0;
+    }
+
+    for (size_t i = 0; i < p; i++) {
+        rhs[i] = gram[i * q + p] / scale[i];
+        for (size_t j = 0; j <= i; j++) {
+            l[i * p + j] = gram[i * q + j] / (scale[i] * scale[j]);
+        }
+    }
+
+    return _staz_cholesky(l, p, STAZ_CHOLESKY_TOL);
+}
+
+/**
+ * @brief Fits y = X beta by ordinary least squares
+ * 
+ * @param X Row-major n x p design matrix (include a column of ones for an intercept)
+ * @param n Number of observations (must exceed p)
+ * @param p Number of predictors
+ * @param y Pointer to the n responses
+ * @param beta_out Output array of p coefficients
+ * @param se_out Output array of p standard errors of the coefficients, or NULL
+ * 
+ * @return double Residual variance SSE / (n - p), NAN on error
+ * 
+ * @note X'X, X'y and y'y come from one cache-blocked, multithreaded pass of
+ *       the covariance kernel over [X y]. The normal equations are scaled
+ *       to a unit diagonal (which removes the conditioning cost of badly
+ *       scaled columns) and solved by Cholesky. A second parallel pass
+ *       computes the residuals (rather than y'y - beta'X'y, which cancels
+ *       on good fits) and X'e, which drives one step of iterative
+ *       refinement of beta.
+ *       On error, beta_out and se_out are filled with NAN.
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if a pointer is NULL, p is 0 or n <= p
+ *       - MEMORY_ALLOCATION_ERROR if memory allocation fails
+ *       - MATH_DOMAIN_ERROR if the design is singular (collinear or zero columns)
+ *       - 0 if operation succeeds
+ */
+double
+staz_ols(const double* X, size_t n, size_t p, const double* y, double* beta_out, double* se_out) {
+    if (!X || !y || !beta_out || p == 0 || n <= p) {
+        errno = INVALID_PARAMETERS_ERROR;
+        if (beta_out) for (size_t j = 0; j < p; j++) beta_out[j] = NAN;
+        if (se_out) for (size_t j = 0; j < p; j++) se_out[j] = NAN;
+        return NAN;
+    }
+
+    const size_t q = p + 1;
+
+    size_t threads = _staz_num_threads();
+    if ((double)n * p < 1e6) threads = 1;
+
+    // Gram matrix of [X y], then the scaled system, its scratch and X'e per
+    // thread, in space first used as the workspace of the Gram kernel
+    const size_t tail = (3 + threads) * p;
+    const size_t kernel = _staz_syrk_work(q);
+
+    double* gram = (double *)malloc((q * q + (tail > kernel ? tail : kernel)) * sizeof(double));
+    if (!gram) {
+        for (size_t j = 0; j < p; j++) beta_out[j] = NAN;
+        if (se_out) for (size_t j = 0; j < p; j++) se_out[j] = NAN;
+        errno = MEMORY_ALLOCATION_ERROR;
+        return NAN;
+    }
+
+    _staz_syrk(X, n, p, y, NULL, gram, gram + q * q);
+
+    double* scale = gram + q * q;
+    double* rhs = scale + p;
+    double* work = rhs + p;
+    double* grad = work + p;
+
+    if (!_staz_normal_factor(gram, p, gram, scale, rhs)) {
+        free(gram);
+        for (size_t j = 0; j < p; j++) beta_out[j] = NAN;
+        if (se_out) for (size_t j = 0; j < p; j++) se_out[j] = NAN;
+        errno = MATH_DOMAIN_ERROR;
+        return NAN;
+    }
+
+    _staz_cholesky_solve(gram, p, rhs);
+    for (size_t j = 0; j < p; j++) beta_out[j] = rhs[j] / scale[j];
+
+    // Residual pass, also accumulating X'e for one step of refinement
+    double sse = 0.0;
+
+    STAZ_OMP(omp parallel for schedule(static) num_threads(threads) reduction(+:sse) if (threads > 1))
+    for (size_t t = 0; t < threads; t++) {
+        double* g = grad + t * p;
+        for (size_t j = 0; j < p; j++) g[j] = 0.0;
+
+        for (size_t i = n * t / threads; i < n * (t + 1) / threads; i++) {
+            const double* row = X + i * p;
+            double fit = 0.0;
+
+            for (size_t j = 0; j < p; j++) fit += row[j] * beta_out[j];
+
+            const double e = y[i] - fit;
+            for (size_t j = 0; j < p; j++) g[j] += row[j] * e;
+            sse += e * e;
+        }
+    }
+
+    // The semi-normal correction X'X d = X'e recovers most of the accuracy
+    // lost to squaring the condition number; SSE drops by exactly d'X'e
+    for (size_t j = 0; j < p; j++) {
+        double s = 0.0;
+        for (size_t t = 0; t < threads; t++) s += grad[t * p + j];
+        rhs[j] = s / scale[j];
+        work[j] = s;
+    }
+
+    _staz_cholesky_solve(gram, p, rhs);
+
+    for (size_t j = 0; j < p; j++) {
+        const double d = rhs[j] / scale[j];
+        beta_out[j] += d;
+        sse -= d * work[j];
+    }
+
+    if (sse < 0) sse = 0;
+    const double variance = sse / (double)(n - p);
+
+    if (se_out) {
+        _staz_cholesky_inverse_diag(gram, p, work, se_out);
+        for (size_t j = 0; j < p; j++) se_out[j] = sqrt(variance * se_out[j]) / scale[j];
+    }
+
+    free(gram);
+
+    errno = 0;
+    return variance;
+}
+
+/* --- ONLINE REGRESSION --- */
+
+/**
+ * @brief Running simple linear regression of y on x over a stream of pairs
+ * 
+ * Holds the weight, means and centered co-moments of the pairs seen. Batches
+ * are reduced with the compensated kernel of staz_linear_regression() and
+ * folded in with Chan's update, so the fit of everything seen is available
+ * in O(1) at any time. The weight is the number of pairs unless
+ * staz_online_regression_decay() discounts the past.
+ */
+typedef struct {
+    double n;      /** Number (or decayed weight) of pairs seen */
+    double mean_x; /** Weighted mean of x */
+    double mean_y; /** Weighted mean of y */
+    double sxx;    /** Weighted sum of (x - mean_x)^2 */
+    double syy;    /** Weighted sum of (y - mean_y)^2 */
+    double sxy;    /** Weighted sum of (x - mean_x) * (y - mean_y) */
+} staz_online_regression;
+
+/**
+ * @brief Creates an empty online regression accumulator
+ */
+staz_online_regression
+staz_online_regression_create(void) {
+    staz_online_regression acc = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    return acc;
+}
+
+/**
+ * @brief Folds the pairs of another accumulator into acc (Chan et al.)
+ * 
+ * @param acc Pointer to the accumulator to update
+ * @param other Pointer to the accumulator to fold in (e.g. from another thread)
+ */
+void
+staz_online_regression_merge(staz_online_regression* acc, const staz_online_regression* other) {
+    if (!acc || !other) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return;
+    }
+
+    errno = 0;
+
+    if (other->n == 0) return;
+    if (acc->n == 0) {
+        *acc = *other;
+        return;
+    }
+
+    const double n = acc->n + other->n;
+    const double dx = other->mean_x - acc->mean_x, dy = other->mean_y - acc->mean_y;
+    const double w = acc->n * other->n / n;
+
+    acc->mean_x += dx * (other->n / n);
+    acc->mean_y += dy * (other->n / n);
+    acc->sxx += other->sxx + dx * dx * w;
+    acc->syy += other->syy + dy * dy * w;
+    acc->sxy += other->sxy + dx * dy * w;
+    acc->n = n;
+}
+
+/**
+ * @brief Adds a batch of pairs to an online regression accumulator
+ * 
+ * @param acc Pointer to the accumulator
+ * @param x Pointer to the batch of x coordinates
+ * @param y Pointer to the batch of y coordinates
+ * @param len Number of pairs in the batch
+ */
+void
+staz_online_regression_update(staz_online_regression* acc, const double* x, const double* y, size_t len) {
+    if (!acc || ((!x || !y) && len > 0)) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return;
+    }
+
+    if (len == 0) {
+        errno = 0;
+        return;
+    }
+
+    const _staz_moments2 m = _staz_comoments2(x, y, len);
+    const staz_online_regression batch = {(double)m.n, m.mean_x, m.mean_y, m.sxx, m.syy, m.sxy};
+
+    staz_online_regression_merge(acc, &batch);
+}
+
+/**
+ * @brief Discounts the pairs seen so far by a forgetting factor
+ * 
+ * @param acc Pointer to the accumulator
+ * @param lambda Forgetting factor in (0, 1]
+ * 
+ * @note Calling this before every update weighs a batch k updates old by
+ *       lambda^k (exponentially weighted least squares). Means are kept;
+ *       the weight and the co-moments shrink.
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if acc is NULL or lambda is not in (0, 1]
+ *       - 0 if operation succeeds
+ */
+void
+staz_online_regression_decay(staz_online_regression* acc, double lambda) {
+    if (!acc || !(lambda > 0 && lambda <= 1)) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return;
+    }
+
+    acc->n *= lambda;
+    acc->sxx *= lambda;
+    acc->syy *= lambda;
+    acc->sxy *= lambda;
+
+    errno = 0;
+}
+
+/**
+ * @brief Best-fit line of the pairs seen so far
+ * 
+ * @return staz_line_equation Slope m and intercept q, both NAN on error
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if acc is NULL or empty
+ *       - ZERO_DIVISION_ERROR if every x seen is equal
+ *       - 0 if operation succeeds
+ */
+staz_line_equation
+staz_online_regression_line(const staz_online_regression* acc) {
+    if (!acc || acc->n == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return (staz_line_equation) {NAN, NAN};
+    }
+
+    if (acc->sxx == 0) {
+        errno = ZERO_DIVISION_ERROR;
+        return (staz_line_equation) {NAN, NAN};
+    }
+
+    errno = 0;
+
+    const double m = acc->sxy / acc->sxx;
+    return (staz_line_equation) {m, acc->mean_y - m * acc->mean_x};
+}
+
+/**
+ * @brief Pearson correlation of the pairs seen so far, NAN on error
+ * 
+ * @note Sets errno to INVALID_PARAMETERS_ERROR if acc is NULL or empty,
+ *       ZERO_DIVISION_ERROR if x or y is constant, 0 otherwise.
+ */
+double
+staz_online_regression_correlation(const staz_online_regression* acc) {
+    if (!acc || acc->n == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    if (acc->sxx == 0 || acc->syy == 0) {
+        errno = ZERO_DIVISION_ERROR;
+        return NAN;
+    }
+
+    errno = 0;
+
+    const double r = acc->sxy / sqrt(acc->sxx * acc->syy);
+    return (r > 1.0) ? 1.0 : (r < -1.0) ? -1.0 : r;
+}
+
+/** Rows per thread below which staz_online_ols_update() stays sequential */
+#ifndef STAZ_ONLINE_OLS_PARALLEL_ROWS
+#define STAZ_ONLINE_OLS_PARALLEL_ROWS 4096
+#endif
+
+/**
+ * @brief Running least squares fit of y on p predictors over a stream of rows
+ * 
+ * Keeps the triangular factor R of the QR decomposition of [X y], updated
+ * with Givens rotations as rows arrive (recursive least squares). Unlike
+ * accumulating X'X, this never squares the condition number of X, and the
+ * residual sum of squares is exactly the square of the last diagonal entry.
+ * Coefficients are solved on demand in O(p^2) (O(p^3) with standard errors).
+ */
+typedef struct {
+    size_t p;        /** Number of predictors */
+    double n;        /** Number (or decayed weight) of rows seen */
+    double* r;       /** Upper triangular factor of [X y] ((p + 1) x (p + 1), row-major) */
+    double* scratch; /** Workspace ((p + 1) + p x p + p values) */
+} staz_online_ols;
+
+/**
+ * @brief Creates an empty online least squares accumulator
+ * 
+ * @param p Number of predictors (include a column of ones in X for an intercept)
+ * 
+ * @return staz_online_ols The accumulator; every field is zero on error
+ * 
+ * @note Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if p is 0
+ *       - MEMORY_ALLOCATION_ERROR if memory allocation fails
+ *       - 0 if operation succeeds
+ */
+staz_online_ols
+staz_online_ols_create(size_t p) {
+    staz_online_ols acc;
+    memset(&acc, 0, sizeof(acc));
+
+    if (p == 0) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return acc;
+    }
+
+    const size_t q = p + 1;
+    double* block = (double *)calloc(q * q + q + p * p + p, sizeof(double));
+    if (!block) {
+        errno = MEMORY_ALLOCATION_ERROR;
+        return acc;
+    }
+
+    acc.p = p;
+    acc.r = block;
+    acc.scratch = block + q * q;
+
+    errno = 0;
+    return acc;
+}
+
+/**
+ * @brief Releases the memory held by an online least squares accumulator
+ */
+void
+staz_online_ols_destroy(staz_online_ols* acc) {
+    if (!acc) return;
+
+    free(acc->r);
+    memset(acc, 0, sizeof(*acc));
+}
+
+/**
+ * @brief Rotates one row of q values into the upper triangular factor r
+ * 
+ * @note One Givens rotation per nonzero entry of the row; the row is
+ *       consumed (left zero up to rounding).
+ */
+static void
+_staz_givens_row(double* r, size_t q, double* row) {
+    for (size_t j = 0; j < q; j++) {
+        if (row[j] == 0) continue;
+
+        double* rj = r + j * q;
+        const double rho = hypot(rj[j], row[j]);
+        const double c = rj[j] / rho, s = row[j] / rho;
+
+        rj[j] = rho;
+        for (size_t k = j + 1; k < q; k++) {
+            const double t = rj[k];
+            rj[k] = c * t + s * row[k];
+            row[k] = c * row[k] - s * t;
+        }
+    }
+}
+
+/**
+ * @brief Rotates rows [begin, end) of [X y] into r, using row (q values) as workspace
+ */
+static void
+_staz_givens_rows(double* r, size_t p, const double* X, const double* y, size_t begin, size_t end, double* row) {
+    for (size_t i = begin; i < end; i++) {
+        memcpy(row, X + i * p, p * sizeof(double));
+        row[p] = y[i];
+        _staz_givens_row(r, p + 1, row);
+    }
+}
+
+/**
+ * @brief Rotates the rows of the triangular factor other into r
+ */
+static void
+_staz_givens_merge(double* r, const double* other, size_t q, double* row) {
+    for (size_t i = 0; i < q; i++) {
+        for (size_t k = 0; k < i; k++) row[k] = 0.0;
+        memcpy(row + i, other + i * q + i, (q - i) * sizeof(double));
+        _staz_givens_row(r, q, row);
+    }
+}
+
+/**
+ * @brief Adds a batch of rows to an online least squares accumulator
+ * 
+ * @param acc Pointer to the accumulator
+ * @param X Row-major count x p matrix of predictors
+ * @param y Pointer to the count responses
+ * @param count Number of rows
+ * 
+ * @note Large batches are split in one range of rows per thread; every
+ *       thread builds the factor of its range, and the factors are merged
+ *       in order. If the per-thread buffers cannot be allocated the batch
+ *       is processed sequentially.
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if acc is not initialized or X or y is NULL with count > 0
+ *       - 0 if operation succeeds
+ */
+void
+staz_online_ols_update(staz_online_ols* acc, const double* X, const double* y, size_t count) {
+    if (!acc || !acc->r || ((!X || !y) && count > 0)) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return;
+    }
+
+    const size_t p = acc->p, q = p + 1;
+    size_t threads = _staz_num_threads();
+    double* parts = NULL;
+
+    if (threads > 1 && count >= threads * STAZ_ONLINE_OLS_PARALLEL_ROWS) {
+        parts = (double *)calloc(threads * (q * q + q), sizeof(double));
+    }
+
+    if (!parts) {
+        _staz_givens_rows(acc->r, p, X, y, 0, count, acc->scratch);
+        acc->n += (double)count;
+        errno = 0;
+        return;
+    }
+
+    STAZ_OMP(omp parallel for schedule(static) num_threads(threads))
+    for (size_t t = 0; t < threads; t++) {
+        double* r = parts + t * (q * q + q);
+        _staz_givens_rows(r, p, X, y, count * t / threads, count * (t + 1) / threads, r + q * q);
+    }
+
+    for (size_t t = 0; t < threads; t++) {
+        _staz_givens_merge(acc->r, parts + t * (q * q + q), q, acc->scratch);
+    }
+
+    free(parts);
+    acc->n += (double)count;
+    errno = 0;
+}
+
+/**
+ * @brief Folds another accumulator over the same predictors into acc
+ * 
+ * @note Sets errno to INVALID_PARAMETERS_ERROR if either accumulator is
+ *       not initialized or their p differ, 0 otherwise.
+ */
+void
+staz_online_ols_merge(staz_online_ols* acc, const staz_online_ols* other) {
+    if (!acc || !other || !acc->r || !other->r || acc->p != other->p) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return;
+    }
+
+    _staz_givens_merge(acc->r, other->r, acc->p + 1, acc->scratch);
+    acc->n += other->n;
+
+    errno = 0;
+}
+
+/**
+ * @brief Discounts the rows seen so far by a forgetting factor
+ * 
+ * @param acc Pointer to the accumulator
+ * @param lambda Forgetting factor in (0, 1]
+ * 
+ * @note Calling this before every update gives exponentially weighted
+ *       recursive least squares over the batches (R is scaled by
+ *       sqrt(lambda), so R'R is scaled by lambda).
+ *       Sets errno to INVALID_PARAMETERS_ERROR if acc is not initialized
+ *       or lambda is not in (0, 1], 0 otherwise.
+ */
+void
+staz_online_ols_decay(staz_online_ols* acc, double lambda) {
+    if (!acc || !acc->r || !(lambda > 0 && lambda <= 1)) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return;
+    }
+
+    const size_t q = acc->p + 1;
+    const double f = sqrt(lambda);
+
+    for (size_t k = 0; k < q * q; k++) acc->r[k] *= f;
+    acc->n *= lambda;
+
+    errno = 0;
+}
+
+/**
+ * @brief Least squares coefficients of the rows seen so far
+ * 
+ * @param acc Pointer to the accumulator
+ * @param beta_out Output array of p coefficients
+ * @param se_out Output array of p standard errors of the coefficients, or NULL
+ * 
+ * @return double Residual variance SSE / (n - p), NAN on error
+ * 
+ * @note beta solves R beta = R'y by back substitution, and SSE is the
+ *       square of the last diagonal entry of R. A column is collinear with
+ *       the previous ones when its diagonal entry, relative to the norm of
+ *       the column, is at most sqrt(STAZ_CHOLESKY_TOL) (the tolerance of
+ *       staz_ols() on the same scale). On error, beta_out and se_out are
+ *       filled with NAN.
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if acc is not initialized, beta_out is NULL or n <= p
+ *       - MATH_DOMAIN_ERROR if the rows seen are collinear
+ *       - 0 if operation succeeds
+ */
+double
+staz_online_ols_coefficients(staz_online_ols* acc, double* beta_out, double* se_out) {
+    const size_t p = (acc && acc->r) ? acc->p : 0;
+    int status = NO_ERROR;
+
+    if (!acc || !acc->r || !beta_out || !(acc->n > (double)p)) status = INVALID_PARAMETERS_ERROR;
+
+    const size_t q = p + 1;
+
+    for (size_t j = 0; status == NO_ERROR && j < p; j++) {
+        double norm = 0.0;
+        for (size_t i = 0; i <= j; i++) norm += acc->r[i * q + j] * acc->r[i * q + j];
+
+        const double d = acc->r[j * q + j];
+        if (!(d * d > STAZ_CHOLESKY_TOL * norm)) status = MATH_DOMAIN_ERROR;
+    }
+
+    if (status != NO_ERROR) {
+        if (beta_out) for (size_t j = 0; j < p; j++) beta_out[j] = NAN;
+        if (se_out) for (size_t j = 0; j < p; j++) se_out[j] = NAN;
+        errno = status;
+        return NAN;
+    }
+
+    const double* r = acc->r;
+
+    for (size_t i = p; i-- > 0; ) {
+        double s = r[i * q + p];
+        for (size_t k = i + 1; k < p; k++) s -= r[i * q + k] * beta_out[k];
+        beta_out[i] = s / r[i * q + i];
+    }
+
+    const double variance = r[p * q + p] * r[p * q + p] / (acc->n - (double)p);
+
+    if (se_out) {
+        // R'R = L L' with L = R' (lower), as the Cholesky helpers expect
+        double* l = acc->scratch + q;
+        double* work = l + p * p;
+
+        for (size_t i = 0; i < p; i++) {
+            for (size_t j = 0; j <= i; j++) l[i * p + j] = r[j * q + i];
+        }
+
+        _staz_cholesky_inverse_diag(l, p, work, se_out);
+        for (size_t j = 0; j < p; j++) se_out[j] = sqrt(variance * se_out[j]);
+    }
+
+    errno = 0;
+    return variance;
+}
 
-    return (staz_line_equation) {
-        m,
-        q
-    };
+/* --- ROLLING REGRESSION --- */
+
+/** Minimum number of slides between exact recomputations of the window co-moments */
+#ifndef STAZ_ROLLING_RESYNC
+#define STAZ_ROLLING_RESYNC 1024
+#endif
+
+/**
+ * @brief Co-moments of a sliding window, relative to a shift picked at every exact recomputation
+ */
+typedef struct {
+    double x0, y0; /** Shift subtracted from every value (the window means at the last recomputation) */
+    double n;      /** Number of pairs in the window */
+    double mx, my; /** Means of the shifted values */
+    double sxx, syy, sxy;
+} _staz_window2;
+
+/**
+ * @brief Recomputes the co-moments of pairs [begin, begin + window) exactly
+ * 
+ * @note The shift moves to the window means, so the slides that follow
+ *       work on nearly centered values; a mean that is not finite (a NAN
+ *       or infinity in the window) gives a shift of 0 instead. The means
+ *       of the shifted values are then summed again with compensation, so
+ *       they keep the part of the true means lost when rounding the shift.
+ */
+static void
+_staz_window2_sync(_staz_window2* w, const double* x, const double* y, size_t begin, size_t window) {
+    const _staz_moments2 m = _staz_comoments2(x + begin, y + begin, window);
+    double sx = 0.0, cx = 0.0, sy = 0.0, cy = 0.0;
+
+    w->x0 = isfinite(m.mean_x) ? m.mean_x : 0.0;
+    w->y0 = isfinite(m.mean_y) ? m.mean_y : 0.0;
+
+    for (size_t i = begin; i < begin + window; i++) {
+        double e, f;
+        const double dx = _staz_two_sum(x[i], -w->x0, &e);
+        sx = _staz_two_sum(sx, dx, &f);
+        cx += e + f;
+
+        const double dy = _staz_two_sum(y[i], -w->y0, &e);
+        sy = _staz_two_sum(sy, dy, &f);
+        cy += e + f;
+    }
+
+    w->n = (double)window;
+    w->mx = (sx + cx) / (double)window;
+    w->my = (sy + cy) / (double)window;
+    w->sxx = m.sxx;
+    w->syy = m.syy;
+    w->sxy = m.sxy;
+}
+
+/**
+ * @brief Writes the fit of the current window at position k of the non-NULL outputs
+ * 
+ * @return int 1 if the window is degenerate (constant x or y), 0 otherwise
+ */
+static int
+_staz_window2_emit(const _staz_window2* w, size_t k, double* slope, double* intercept, double* r) {
+    const int flat_x = !(w->sxx > 0), flat_y = !(w->syy > 0);
+    const double m = flat_x ? NAN : w->sxy / w->sxx;
+
+    if (slope) slope[k] = m;
+    if (intercept) intercept[k] = (w->my + w->y0) - m * (w->mx + w->x0);
+
+    if (r) {
+        double c = (flat_x || flat_y) ? NAN : w->sxy / sqrt(w->sxx * w->syy);
+        if (c > 1.0) c = 1.0;
+        if (c < -1.0) c = -1.0;
+        r[k] = c;
+    }
+
+    return (flat_x || (r && flat_y)) && !isnan(w->sxx + w->syy + w->sxy);
+}
+
+/**
+ * @brief Shared kernel of staz_rolling_regression() and staz_rolling_correlation()
+ * 
+ * @return int Nonzero if some window was degenerate
+ * 
+ * @note Output k covers pairs [k, k + window). The outputs are split in one
+ *       range per thread; every range starts from an exact computation of
+ *       its first window and then slides with O(1) Welford add/remove
+ *       updates. The window is recomputed exactly every
+ *       max(window, STAZ_ROLLING_RESYNC) slides, whenever a slide shrinks
+ *       a sum of squares by more than 2^26 (so a window turning constant
+ *       reads as exactly constant), and right after a NAN or infinity
+ *       leaves it, so a bad value only affects the windows that contain it.
+ */
+static int
+_staz_rolling(const double* x, const double* y, size_t len, size_t window,
+              double* slope, double* intercept, double* r) {
+    const size_t count = len - window + 1;
+    const size_t period = (window > STAZ_ROLLING_RESYNC) ? window : STAZ_ROLLING_RESYNC;
+    size_t threads = _staz_num_threads();
+    int degenerate = 0;
+
+    // Each range starts with a full window, so only split into long ranges
+    if (count < STAZ_PARALLEL_THRESHOLD) threads = 1;
+    while (threads > 1 && count / threads < 4 * window) threads--;
+
+    STAZ_OMP(omp parallel for schedule(static) num_threads(threads) reduction(|:degenerate) if (threads > 1))
+    for (size_t t = 0; t < threads; t++) {
+        const size_t begin = count * t / threads;
+        const size_t end = count * (t + 1) / threads;
+
+        _staz_window2 w;
+        _staz_window2_sync(&w, x, y, begin, window);
+        degenerate |= _staz_window2_emit(&w, begin, slope, intercept, r);
+
+        size_t since = 0;
+
+        for (size_t k = begin + 1; k < end; k++) {
+            const double xo = x[k - 1] - w.x0, yo = y[k - 1] - w.y0;
+            const double xi = x[k + window - 1] - w.x0, yi = y[k + window - 1] - w.y0;
+
+            const double sxx = w.sxx, syy = w.syy;
+            int sync = ++since >= period || !isfinite(xo + yo);
+
+            if (!sync) {
+                // Remove the pair leaving the window
+                const double n1 = w.n - 1.0;
+                const double dxo = xo - w.mx, dyo = yo - w.my;
+                const double mx = w.mx - dxo / n1, my = w.my - dyo / n1;
+
+                w.sxx -= dxo * (xo - mx);
+                w.syy -= dyo * (yo - my);
+                w.sxy -= dxo * (yo - my);
+
+                // Add the pair entering it
+                const double dxi = xi - mx, dyi = yi - my;
+
+                w.mx = mx + dxi / w.n;
+                w.my = my + dyi / w.n;
+                w.sxx += dxi * (xi - w.mx);
+                w.syy += dyi * (yi - w.my);
+                w.sxy += dxi * (yi - w.my);
+
+                // A collapse of the spread leaves mostly rounding error behind
+                sync = w.sxx * 67108864.0 < sxx || w.syy * 67108864.0 < syy;
+            }
+
+            if (sync) {
+                _staz_window2_sync(&w, x, y, k, window);
+                since = 0;
+            }
+
+            degenerate |= _staz_window2_emit(&w, k, slope, intercept, r);
+        }
+    }
+
+    return degenerate;
+}
+
+/**
+ * @brief Fits a line over every window of consecutive pairs
+ * 
+ * @param x Pointer to the array of x coordinates
+ * @param y Pointer to the array of y coordinates
+ * @param len Length of both arrays
+ * @param window Number of pairs per window (at least 2, at most len)
+ * @param slope Output array of len - window + 1 slopes, or NULL
+ * @param intercept Output array of len - window + 1 intercepts, or NULL
+ * @param r Output array of len - window + 1 Pearson correlations, or NULL
+ * 
+ * @note Entry k of every output describes pairs [k, k + window). The whole
+ *       series is read once: windowed co-moments slide with O(1) updates
+ *       and are periodically recomputed exactly (see STAZ_ROLLING_RESYNC),
+ *       in parallel over ranges of windows. Windows with constant x have a
+ *       NAN slope and intercept; windows with constant x or y have a NAN r.
+ *       Windows containing NAN give NAN.
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if x or y is NULL or window is not in [2, len]
+ *       - ZERO_DIVISION_ERROR if some requested output was NAN for a constant window
+ *       - 0 if operation succeeds
+ */
+void
+staz_rolling_regression(const double* x, const double* y, size_t len, size_t window,
+                        double* slope, double* intercept, double* r) {
+    if (!x || !y || window < 2 || window > len) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return;
+    }
+
+    if (!slope && !intercept && !r) {
+        errno = 0;
+        return;
+    }
+
+    errno = _staz_rolling(x, y, len, window, slope, intercept, r) ? ZERO_DIVISION_ERROR : 0;
+}
+
+/**
+ * @brief Pearson correlation over every window of consecutive pairs
+ * 
+ * @param x Pointer to the first array of double values
+ * @param y Pointer to the second array of double values
+ * @param len Length of both arrays
+ * @param window Number of pairs per window (at least 2, at most len)
+ * @param out Output array of len - window + 1 correlations
+ * 
+ * @note Same sliding kernel as staz_rolling_regression(). Windows with
+ *       constant x or y give NAN.
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if a pointer is NULL or window is not in [2, len]
+ *       - ZERO_DIVISION_ERROR if some window was constant
+ *       - 0 if operation succeeds
+ */
+void
+staz_rolling_correlation(const double* x, const double* y, size_t len, size_t window, double* out) {
+    if (!x || !y || !out || window < 2 || window > len) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return;
+    }
+
+    errno = _staz_rolling(x, y, len, window, NULL, NULL, out) ? ZERO_DIVISION_ERROR : 0;
+}
+
+/* --- POLYNOMIAL REGRESSION --- */
+
+/** Highest degree staz_polyfit() accepts */
+#ifndef STAZ_POLYFIT_MAX_DEGREE
+#define STAZ_POLYFIT_MAX_DEGREE 16
+#endif
+
+/**
+ * @brief Least squares polynomial in the orthogonal basis of its data (Forsythe)
+ * 
+ * The fit is sum_k coef[k] * P_k(t) with t = (x - shift) * scale mapping the
+ * data range onto [-1, 1], P_0 = 1, P_1 = t - alpha[0] and
+ * P_k+1 = (t - alpha[k]) * P_k - beta[k] * P_k-1. The P_k are orthogonal
+ * over the fitted points, so the coefficients never go through an
+ * ill-conditioned (Vandermonde) system.
+ */
+typedef struct {
+    size_t degree;                             /** Degree of the polynomial */
+    double shift;                              /** Center of the x range */
+    double scale;                              /** 2 / width of the x range */
+    double alpha[STAZ_POLYFIT_MAX_DEGREE + 1]; /** Recurrence coefficients alpha_k */
+    double beta[STAZ_POLYFIT_MAX_DEGREE + 1];  /** Recurrence coefficients beta_k (beta[0] = 0) */
+    double coef[STAZ_POLYFIT_MAX_DEGREE + 1];  /** Coefficients of P_0 .. P_degree */
+} staz_polynomial;
+
+/**
+ * @brief One pass of staz_polyfit(): moments of P_k and of the residual before it
+ * 
+ * @note Every point evaluates P_0 .. P_k by the recurrence while removing
+ *       the components already fitted from y (as modified Gram-Schmidt
+ *       would), so nothing but x and y is read. Points are processed in 4
+ *       independent lanes, and in parallel with OpenMP.
+ */
+static void
+_staz_polyfit_pass(const staz_polynomial* poly, size_t k, const double* x, const double* y, size_t len,
+                   double* norm, double* tnorm, double* proj) {
+    double s = 0.0, st = 0.0, sy = 0.0;
+    const size_t body = len & ~(size_t)3;
+
+    STAZ_OMP(omp parallel for schedule(static) reduction(+:s, st, sy) if (len * (k + 1) >= STAZ_PARALLEL_THRESHOLD))
+    for (size_t i = 0; i < body; i += 4) {
+        double t[4], prev[4], cur[4], r[4];
+
+        for (size_t l = 0; l < 4; l++) {
+            t[l] = (x[i + l] - poly->shift) * poly->scale;
+            prev[l] = 0.0;
+            cur[l] = 1.0;
+            r[l] = y[i + l];
+        }
+
+        for (size_t j = 0; j < k; j++) {
+            for (size_t l = 0; l < 4; l++) {
+                r[l] -= poly->coef[j] * cur[l];
+                const double next = (t[l] - poly->alpha[j]) * cur[l] - poly->beta[j] * prev[l];
+                prev[l] = cur[l];
+                cur[l] = next;
+            }
+        }
+
+        for (size_t l = 0; l < 4; l++) {
+            s += cur[l] * cur[l];
+            st += t[l] * cur[l] * cur[l];
+            sy += r[l] * cur[l];
+        }
+    }
+
+    for (size_t i = body; i < len; i++) {
+        const double t = (x[i] - poly->shift) * poly->scale;
+        double prev = 0.0, cur = 1.0, r = y[i];
+
+        for (size_t j = 0; j < k; j++) {
+            r -= poly->coef[j] * cur;
+            const double next = (t - poly->alpha[j]) * cur - poly->beta[j] * prev;
+            prev = cur;
+            cur = next;
+        }
+
+        s += cur * cur;
+        st += t * cur * cur;
+        sy += r * cur;
+    }
+
+    *norm = s;
+    *tnorm = st;
+    *proj = sy;
+}
+
+/**
+ * @brief Fits a polynomial of the given degree to the points (x, y) by least squares
+ * 
+ * @param x Pointer to the array of x coordinates
+ * @param y Pointer to the array of y coordinates
+ * @param len Length of both arrays
+ * @param degree Degree of the polynomial (at most STAZ_POLYFIT_MAX_DEGREE)
+ * 
+ * @return staz_polynomial The fitted polynomial; every coefficient is NAN on error
+ * 
+ * @note Forsythe's method: pass k over the data yields alpha_k, beta_k and
+ *       coef[k] from sums of P_k^2, t * P_k^2 and residual * P_k, so the
+ *       fit costs degree + 1 streaming, multithreaded passes and no linear
+ *       system. Evaluate with staz_polynomial_eval() or
+ *       staz_polynomial_evaluate(); staz_polynomial_monomial() converts to
+ *       powers of x.
+ *       Sets errno to:
+ *       - INVALID_PARAMETERS_ERROR if x or y is NULL, degree exceeds
+ *         STAZ_POLYFIT_MAX_DEGREE or len <= degree
+ *       - NAN_ERROR if x or y contains NAN
+ *       - MATH_DOMAIN_ERROR if there are fewer than degree + 1 distinct x
+ *       - 0 if operation succeeds
+ */
+staz_polynomial
+staz_polyfit(const double* x, const double* y, size_t len, size_t degree) {
+    staz_polynomial poly;
+    poly.degree = 0;
+    poly.shift = NAN;
+    poly.scale = NAN;
+    for (size_t k = 0; k <= STAZ_POLYFIT_MAX_DEGREE; k++) {
+        poly.alpha[k] = NAN;
+        poly.beta[k] = NAN;
+        poly.coef[k] = NAN;
+    }
+
+    if (!x || !y || degree > STAZ_POLYFIT_MAX_DEGREE || len <= degree) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return poly;
+    }
+
+    const staz_polynomial failed = poly;
+    const double lo = staz_min_value(x, len), hi = staz_max_value(x, len);
+
+    poly.degree = degree;
+    poly.shift = 0.5 * lo + 0.5 * hi;
+    poly.scale = (hi > lo) ? 2.0 / (hi - lo) : 1.0;
+
+    double norm0 = 0.0, prev = 0.0;
+
+    for (size_t k = 0; k <= degree; k++) {
+        double norm, tnorm, proj;
+        _staz_polyfit_pass(&poly, k, x, y, len, &norm, &tnorm, &proj);
+
+        if (isnan(norm + tnorm + proj)) {
+            errno = NAN_ERROR;
+            return failed;
+        }
+
+        if (k == 0) norm0 = norm;
+
+        // Once the points cannot tell P_k from 0, only rounding is left
+        if (!(norm > norm0 * 1e-24)) {
+            errno = MATH_DOMAIN_ERROR;
+            return failed;
+        }
+
+        poly.coef[k] = proj / norm;
+        poly.alpha[k] = tnorm / norm;
+        poly.beta[k] = (k == 0) ? 0.0 : norm / prev;
+        prev = norm;
+    }
+
+    errno = 0;
+    return poly;
+}
+
+/**
+ * @brief Value of a fitted polynomial at x (Clenshaw's recurrence)
+ * 
+ * @note Sets errno to INVALID_PARAMETERS_ERROR and returns NAN if poly is NULL.
+ */
+double
+staz_polynomial_eval(const staz_polynomial* poly, double x) {
+    if (!poly) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return NAN;
+    }
+
+    const double t = (x - poly->shift) * poly->scale;
+    double b1 = 0.0, b2 = 0.0;
+
+    for (size_t k = poly->degree + 1; k-- > 0; ) {
+        const double b = poly->coef[k] + (t - poly->alpha[k]) * b1
+                         - ((k < poly->degree) ? poly->beta[k + 1] * b2 : 0.0);
+        b2 = b1;
+        b1 = b;
+    }
+
+    errno = 0;
+    return b1;
+}
+
+/**
+ * @brief Evaluates a fitted polynomial at every x, in parallel
+ * 
+ * @param poly Pointer to the fitted polynomial
+ * @param x Pointer to the array of x values
+ * @param len Length of the array
+ * @param out Output array of len fitted values (may be x itself)
+ * 
+ * @note Sets errno to INVALID_PARAMETERS_ERROR if a pointer is NULL, 0 otherwise.
+ */
+void
+staz_polynomial_evaluate(const staz_polynomial* poly, const double* x, size_t len, double* out) {
+    if (!poly || !x || !out) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return;
+    }
+
+    const size_t d = poly->degree;
+
+    STAZ_OMP(omp parallel for schedule(static) if (len * (d + 1) >= STAZ_PARALLEL_THRESHOLD))
+    for (size_t i = 0; i < len; i++) {
+        const double t = (x[i] - poly->shift) * poly->scale;
+        double b1 = poly->coef[d], b2 = 0.0;
+
+        for (size_t k = d; k-- > 0; ) {
+            const double b = poly->coef[k] + (t - poly->alpha[k]) * b1 - poly->beta[k + 1] * b2;
+            b2 = b1;
+            b1 = b;
+        }
+
+        out[i] = b1;
+    }
+
+    errno = 0;
+}
+
+/**
+ * @brief Converts a fitted polynomial to coefficients of powers of x
+ * 
+ * @param poly Pointer to the fitted polynomial
+ * @param coeffs Output array of degree + 1 values: coeffs[j] multiplies x^j
+ * 
+ * @note The monomial form is ill-conditioned when the x range is far from
+ *       0 or wide; prefer staz_polynomial_eval() to compute fitted values.
+ *       Sets errno to INVALID_PARAMETERS_ERROR if a pointer is NULL, 0 otherwise.
+ */
+void
+staz_polynomial_monomial(const staz_polynomial* poly, double* coeffs) {
+    if (!poly || !coeffs) {
+        errno = INVALID_PARAMETERS_ERROR;
+        return;
+    }
+
+    const size_t d = poly->degree;
+    double prev[STAZ_POLYFIT_MAX_DEGREE + 1] = {0.0};
+    double cur[STAZ_POLYFIT_MAX_DEGREE + 1] = {0.0};
+    double in_t[STAZ_POLYFIT_MAX_DEGREE + 1] = {0.0};
+
+    // Powers of t in every P_k, summed with the fitted weights
+    cur[0] = 1.0;
+    for (size_t k = 0; k <= d; k++) {
+        for (size_t j = 0; j <= k; j++) in_t[j] += poly->coef[k] * cur[j];
+        if (k == d) break;
+
+        // P_k+1 = t * P_k - alpha_k * P_k - beta_k * P_k-1
+        double next[STAZ_POLYFIT_MAX_DEGREE + 1] = {0.0};
+        for (size_t j = 0; j <= k; j++) {
+            next[j + 1] += cur[j];
+            next[j] -= poly->alpha[k] * cur[j] + poly->beta[k] * prev[j];
+        }
+
+        memcpy(prev, cur, sizeof(cur));
+        memcpy(cur, next, sizeof(next));
+    }
+
+    // Substitute t = scale * x + offset by Horner's rule on polynomials
+    const double offset = -poly->shift * poly->scale;
+
+    for (size_t j = 0; j <= d; j++) coeffs[j] = 0.0;
+    coeffs[0] = in_t[d];
+
+    for (size_t k = d; k-- > 0; ) {
+        for (size_t j = d - k; j > 0; j--) {
+            coeffs[j] = coeffs[j] * offset + coeffs[j - 1] * poly->scale;
+        }
+        coeffs[0] = coeffs[0] * offset + in_t[k];
+    }
+
+    errno = 0;
 }
 
 #ifdef __cplusplus
 }
 #endif
 
+/* --- C++ FIXED-SIZE OVERLOADS --- */
+
+#if defined(__cplusplus) && __cplusplus >= 201402L
+
+#include <limits>
+
+/*
+ * Overloads for arrays whose length is known at compile time. They keep
+ * everything on the stack, sort with Batcher's odd-even merge network (a
+ * loop nest over the comparator schedule, which depends only on N) and
+ * can be evaluated in constexpr contexts. They do not touch errno and,
+ * unlike their C counterparts, never modify the input array.
+ */
+
+namespace staz_detail {
+
+/** Ascending order with NAN after every number */
+constexpr bool
+less(double a, double b) {
+    return a < b || (a == a && b != b);
+}
+
+template <std::size_t N>
+struct sorted_array {
+    double v[N];
+};
+
+template <std::size_t N>
+constexpr sorted_array<N>
+sort(const double (&nums)[N]) {
+    sorted_array<N> s{};
+
+    for (std::size_t i = 0; i < N; i++) s.v[i] = nums[i];
+
+    for (std::size_t p = 1; p < N; p <<= 1) {
+        for (std::size_t k = p; k >= 1; k >>= 1) {
+            for (std::size_t j = k % p; j + k < N; j += 2 * k) {
+                for (std::size_t i = 0; i < k && i + j + k < N; i++) {
+                    if ((i + j) / (2 * p) == (i + j + k) / (2 * p)) {
+                        const double a = s.v[i + j], b = s.v[i + j + k];
+                        const bool swap = less(b, a);
+
+                        s.v[i + j] = swap ? b : a;
+                        s.v[i + j + k] = swap ? a : b;
+                    }
+                }
+            }
+        }
+    }
+
+    return s;
+}
+
+template <std::size_t N>
+constexpr double
+quantile_sorted(const sorted_array<N>& s, int mtype, std::size_t posx) {
+    const double index = posx * (N + 1) / (double)mtype;
+    const std::size_t lower = (std::size_t)index;
+
+    if (lower >= N) return s.v[N - 1];
+    if (lower == 0) return s.v[0];
+
+    return s.v[lower - 1] + (index - lower) * (s.v[lower] - s.v[lower - 1]);
+}
+
+} // namespace staz_detail
+
+template <std::size_t N>
+constexpr double
+staz_sum(const double (&nums)[N]) {
+    static_assert(N > 0, "staz: empty array");
+
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    std::size_t i = 0;
+
+    for (; i + 4 <= N; i += 4) {
+        s0 += nums[i];
+        s1 += nums[i + 1];
+        s2 += nums[i + 2];
+        s3 += nums[i + 3];
+    }
+    for (; i < N; i++) s0 += nums[i];
+
+    return (s0 + s1) + (s2 + s3);
+}
+
+template <std::size_t N>
+constexpr double
+staz_quadratic_sum(const double (&nums)[N]) {
+    static_assert(N > 0, "staz: empty array");
+
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    std::size_t i = 0;
+
+    for (; i + 4 <= N; i += 4) {
+        s0 += nums[i] * nums[i];
+        s1 += nums[i + 1] * nums[i + 1];
+        s2 += nums[i + 2] * nums[i + 2];
+        s3 += nums[i + 3] * nums[i + 3];
+    }
+    for (; i < N; i++) s0 += nums[i] * nums[i];
+
+    return (s0 + s1) + (s2 + s3);
+}
+
+template <std::size_t N>
+constexpr double
+staz_min_value(const double (&nums)[N]) {
+    static_assert(N > 0, "staz: empty array");
+
+    double min = nums[0];
+    for (std::size_t i = 1; i < N; i++) {
+        if (nums[i] < min) min = nums[i];
+    }
+
+    return min;
+}
+
+template <std::size_t N>
+constexpr double
+staz_max_value(const double (&nums)[N]) {
+    static_assert(N > 0, "staz: empty array");
+
+    double max = nums[0];
+    for (std::size_t i = 1; i < N; i++) {
+        if (nums[i] > max) max = nums[i];
+    }
+
+    return max;
+}
+
+template <std::size_t N>
+constexpr double
+staz_median(const double (&nums)[N]) {
+    static_assert(N > 0, "staz: empty array");
+
+    const staz_detail::sorted_array<N> s = staz_detail::sort(nums);
+
+    return (N % 2 != 0) ? s.v[N / 2] : (s.v[N / 2 - 1] + s.v[N / 2]) / 2.0;
+}
+
+/**
+ * @note Returns NAN if posx is not between 1 and mtype-1
+ */
+template <std::size_t N>
+constexpr double
+staz_quantile(int mtype, std::size_t posx, const double (&nums)[N]) {
+    static_assert(N > 0, "staz: empty array");
+
+    if (posx < 1 || posx > (std::size_t)mtype - 1) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    return staz_detail::quantile_sorted(staz_detail::sort(nums), mtype, posx);
+}
+
+/**
+ * @note ARITHMETICAL, EXTREMES, TRIMEAN and MIDHINGE are constexpr; the
+ *       other mean types fall back to the C implementation at run time.
+ */
+template <std::size_t N>
+constexpr double
+staz_mean(staz_mean_type mtype, const double (&nums)[N]) {
+    static_assert(N > 0, "staz: empty array");
+
+    switch (mtype) {
+    case ARITHMETICAL:
+        return staz_sum(nums) / N;
+
+    case EXTREMES:
+        return (N < 2) ? std::numeric_limits<double>::quiet_NaN()
+                       : (staz_min_value(nums) + staz_max_value(nums)) / 2.0;
+
+    case TRIMEAN: {
+        const staz_detail::sorted_array<N> s = staz_detail::sort(nums);
+
+        return (staz_detail::quantile_sorted(s, 4, 1)
+                + 2 * staz_detail::quantile_sorted(s, 4, 2)
+                + staz_detail::quantile_sorted(s, 4, 3)) / 4.0;
+    }
+
+    case MIDHINGE: {
+        const staz_detail::sorted_array<N> s = staz_detail::sort(nums);
+
+        return (staz_detail::quantile_sorted(s, 4, 1) + staz_detail::quantile_sorted(s, 4, 3)) / 2;
+    }
+
+    default:
+        return staz_mean(mtype, const_cast<double*>(nums), N);
+    }
+}
+
+/**
+ * @note Two-pass population variance; the input array is left untouched
+ */
+template <std::size_t N>
+constexpr double
+staz_variance(const double (&nums)[N]) {
+    static_assert(N > 0, "staz: empty array");
+
+    const double mean_value = staz_sum(nums) / N;
+    double s0 = 0.0, s1 = 0.0;
+    std::size_t i = 0;
+
+    for (; i + 2 <= N; i += 2) {
+        s0 += (nums[i] - mean_value) * (nums[i] - mean_value);
+        s1 += (nums[i + 1] - mean_value) * (nums[i + 1] - mean_value);
+    }
+    for (; i < N; i++) s0 += (nums[i] - mean_value) * (nums[i] - mean_value);
+
+    return (s0 + s1) / N;
+}
+
+#endif
+
 #endif /* STAZ_H */
\ No newline at end of file
@@ -0,0 +1,806 @@
+/*
+ * staz - command-line statistics over files and stdin
+ *
+ * Build (from the repository root):
+ *
+ *     cc -O2 -fopenmp tools/staz.c -o staz -lm
+ *
+ * Drop -fopenmp for a single-threaded build.
+ *
+ * Usage: staz [options] [file ...]
+ *
+ *   -d DELIM   field delimiter of text input (default ','; "tab" for '\t')
+ *   -c COL     1-based column holding the values (default 1)
+ *   -k COL     1-based column to group by (text input only)
+ *   -b TYPE    raw binary input of type f64 or f32 instead of text
+ *   -s LIST    comma-separated statistics (default count,mean,sd,min,max):
+ *              count sum mean var sd min max range median q1 q3 iqr pN
+ *              (pN is the N-th percentile in steps of 0.1, e.g. p99 or p99.9)
+ *   -f FORMAT  tsv (default) or json
+ *
+ * With no file, or with "-", input is read from stdin. Lines whose value is
+ * missing or not a finite number (headers, blanks, nan, inf) are skipped.
+ * Raw binary values are taken as they are.
+ *
+ * Moments are computed with streaming accumulators, so memory stays constant
+ * unless an order statistic (median, quartiles, percentiles) is requested.
+ * Regular files are memory-mapped on POSIX systems and, when not grouped,
+ * parsed by all threads at once.
+ */
+
+#include "../staz.h"
+
+#include <stdio.h>
+
+#define STAZ_CLI_READ_CHUNK (1u << 20)
+
+typedef enum {
+    STAT_COUNT, STAT_SUM, STAT_MEAN, STAT_VAR, STAT_SD,
+    STAT_MIN, STAT_MAX, STAT_RANGE, STAT_MEDIAN, STAT_Q1,
+    STAT_Q3, STAT_IQR, STAT_PERCENTILE
+} stat_kind;
+
+typedef struct {
+    stat_kind kind;
+    size_t permille; /* for STAT_PERCENTILE */
+    char name[16];
+} stat_spec;
+
+typedef struct {
+    char* key;
+    staz_online acc;
+    double* vals;
+    size_t n, cap;
+} group;
+
+typedef struct {
+    char delim;
+    size_t column;   /* 0-based */
+    size_t key;      /* 0-based, SIZE_MAX if not grouped */
+    int binary;
+    staz_column_type type;
+    int json;
+    stat_spec stats[64];
+    size_t nstats;
+    int keep;        /* 1 if values must be kept for order statistics */
+
+    group* groups;
+    size_t ngroups, gcap;
+    size_t* table;   /* open addressing, SIZE_MAX for empty slots */
+    size_t tcap;
+} cli;
+
+static void
+die(const char* msg, const char* what) {
+    fprintf(stderr, "staz: %s%s%s\n", msg, what ? ": " : "", what ? what : "");
+    exit(1);
+}
+
+static void*
+xrealloc(void* p, size_t bytes) {
+    void* q = realloc(p, bytes ? bytes : 1);
+    if (!q) die("out of memory", NULL);
+    return q;
+}
+
+static size_t
+max_threads(void) {
+#ifdef _OPENMP
+    return (size_t)omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+static int
+little_endian(void) {
+    const unsigned short probe = 1;
+    unsigned char first;
+    memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+/* --- OPTIONS --- */
+
+static size_t
+parse_column(const char* s) {
+    char* end;
+    const long v = strtol(s, &end, 10);
+    if (*end || v < 1) die("invalid column", s);
+    return (size_t)v - 1;
+}
+
+static void
+parse_stats(cli* c, const char* list) {
+    static const struct { const char* name; stat_kind kind; } names[] = {
+        {"count", STAT_COUNT}, {"sum", STAT_SUM}, {"mean", STAT_MEAN},
+        {"var", STAT_VAR}, {"sd", STAT_SD}, {"min", STAT_MIN},
+        {"max", STAT_MAX}, {"range", STAT_RANGE}, {"median", STAT_MEDIAN},
+        {"q1", STAT_Q1}, {"q3", STAT_Q3}, {"iqr", STAT_IQR},
+    };
+
+    c->nstats = 0;
+    c->keep = 0;
+
+    for (const char* p = list; *p; ) {
+        const char* comma = strchr(p, ',');
+        const size_t n = comma ? (size_t)(comma - p) : strlen(p);
+
+        if (c->nstats == sizeof(c->stats) / sizeof(c->stats[0])) die("too many statistics", NULL);
+        if (n == 0 || n >= sizeof(c->stats[0].name)) die("invalid statistic", p);
+
+        stat_spec* s = &c->stats[c->nstats++];
+        memcpy(s->name, p, n);
+        s->name[n] = '\0';
+
+        size_t i = 0;
+        for (; i < sizeof(names) / sizeof(names[0]); i++) {
+            if (strcmp(s->name, names[i].name) == 0) break;
+        }
+
+        if (i < sizeof(names) / sizeof(names[0])) {
+            s->kind = names[i].kind;
+        } else if (s->name[0] == 'p') {
+            char* end;
+            const double pct = strtod(s->name + 1, &end);
+            if (*end || !(pct > 0 && pct < 100)) die("invalid percentile", s->name);
+
+            /* Quantiles are taken in thousandths, so pN must be a multiple of 0.1 */
+            s->kind = STAT_PERCENTILE;
+            s->permille = (size_t)(pct * 10 + 0.5);
+            if (fabs(pct * 10 - (double)s->permille) > 1e-6) die("percentile not a multiple of 0.1", s->name);
+            if (s->permille == 0 || s->permille >= 1000) die("invalid percentile", s->name);
+        } else {
+            die("unknown statistic", s->name);
+        }
+
+        if (s->kind >= STAT_MEDIAN) c->keep = 1;
+
+        p += n + (comma != NULL);
+    }
+
+    if (c->nstats == 0) die("no statistics requested", NULL);
+}
+
+/* --- GROUPS --- */
+
+static uint64_t
+hash_key(const char* s, size_t n) {
+    uint64_t h = 1469598103934665603ULL; /* FNV-1a */
+    for (size_t i = 0; i < n; i++) {
+        h = (h ^ (unsigned char)s[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+static group*
+new_group(cli* c, const char* key, size_t n) {
+    if (c->ngroups == c->gcap) {
+        c->gcap = c->gcap ? c->gcap * 2 : 16;
+        c->groups = (group *)xrealloc(c->groups, c->gcap * sizeof(group));
+    }
+
+    group* g = &c->groups[c->ngroups++];
+    g->key = (char *)xrealloc(NULL, n + 1);
+    memcpy(g->key, key, n);
+    g->key[n] = '\0';
+    g->acc = staz_online_create();
+    g->vals = NULL;
+    g->n = g->cap = 0;
+    return g;
+}
+
+static void
+grow_table(cli* c) {
+    free(c->table);
+    c->tcap = c->tcap ? c->tcap * 2 : 64;
+    c->table = (size_t *)xrealloc(NULL, c->tcap * sizeof(size_t));
+    for (size_t i = 0; i < c->tcap; i++) c->table[i] = SIZE_MAX;
+
+    for (size_t g = 0; g < c->ngroups; g++) {
+        const char* k = c->groups[g].key;
+        size_t slot = (size_t)hash_key(k, strlen(k)) & (c->tcap - 1);
+        while (c->table[slot] != SIZE_MAX) slot = (slot + 1) & (c->tcap - 1);
+        c->table[slot] = g;
+    }
+}
+
+static group*
+find_group(cli* c, const char* key, size_t n) {
+    if (2 * (c->ngroups + 1) > c->tcap) grow_table(c);
+
+    size_t slot = (size_t)hash_key(key, n) & (c->tcap - 1);
+    for (; c->table[slot] != SIZE_MAX; slot = (slot + 1) & (c->tcap - 1)) {
+        group* g = &c->groups[c->table[slot]];
+        if (strncmp(g->key, key, n) == 0 && g->key[n] == '\0') return g;
+    }
+
+    c->table[slot] = c->ngroups;
+    return new_group(c, key, n);
+}
+
+static void
+reserve(group* g, size_t extra) {
+    if (g->n + extra <= g->cap) return;
+
+    g->cap = (g->n + extra > 2 * g->cap) ? g->n + extra : 2 * g->cap;
+    g->vals = (double *)xrealloc(g->vals, g->cap * sizeof(double));
+}
+
+/* --- INPUT --- */
+
+/* Drops nan and inf from vals, keeping the order; returns the count left */
+static size_t
+keep_finite(double* vals, size_t n) {
+    size_t k = 0;
+    for (size_t i = 0; i < n; i++) {
+        vals[k] = vals[i];
+        k += (isfinite(vals[i]) != 0);
+    }
+    return k;
+}
+
+/* Locates field idx of [p, eol); returns 0 if the line is shorter */
+static int
+field_of(const char* p, const char* eol, char delim, size_t idx, const char** fb, const char** fe) {
+    for (size_t i = 0; i < idx; i++) {
+        p = staz_text_find(p, eol, delim, delim);
+        if (p == eol) return 0;
+        p++;
+    }
+
+    *fb = p;
+    *fe = staz_text_find(p, eol, delim, delim);
+    return 1;
+}
+
+static void
+trim(const char** b, const char** e) {
+    while (*b < *e && (**b == ' ' || **b == '\t')) (*b)++;
+    while (*e > *b && ((*e)[-1] == ' ' || (*e)[-1] == '\t' || (*e)[-1] == '\r')) (*e)--;
+}
+
+/* Grouped text: one hash lookup per line */
+static size_t
+feed_grouped(cli* c, const char* text, size_t len, int last) {
+    const char* p = text;
+    const char* end = text + len;
+
+    while (p < end) {
+        const char* eol = staz_text_find(p, end, '\n', '\n');
+        if (eol == end && !last) break;
+
+        const char *kb, *ke, *vb, *ve;
+        double v;
+
+        if (field_of(p, eol, c->delim, c->key, &kb, &ke) &&
+            field_of(p, eol, c->delim, c->column, &vb, &ve)) {
+            trim(&kb, &ke);
+            trim(&vb, &ve);
+
+            if (vb < ve && staz_parse_double(vb, ve, &v) == ve && isfinite(v)) {
+                group* g = find_group(c, kb, (size_t)(ke - kb));
+
+                staz_online_update(&g->acc, &v, 1);
+                if (c->keep) {
+                    reserve(g, 1);
+                    g->vals[g->n++] = v;
+                }
+            }
+        }
+
+        p = (eol < end) ? eol + 1 : end;
+    }
+
+    return (size_t)(p - text);
+}
+
+/* Ungrouped text into g; returns the bytes consumed */
+static size_t
+feed_text(const cli* c, group* g, const char* text, size_t len, int last) {
+    if (!c->keep) {
+        /* Batches on the stack keep memory constant */
+        double batch[512];
+        size_t pos = 0;
+
+        while (pos < len) {
+            size_t part;
+            const size_t n = staz_csv_parse(text + pos, len - pos, c->delim, c->column, batch, 512, &part);
+
+            staz_online_update(&g->acc, batch, keep_finite(batch, n));
+            pos += part;
+
+            if (part == 0) break; /* only an unterminated line is left */
+        }
+
+        if (last && pos < len) {
+            const size_t n = staz_csv_parse(text + pos, len - pos, c->delim, c->column, batch, 512, NULL);
+
+            staz_online_update(&g->acc, batch, keep_finite(batch, n));
+            pos = len;
+        }
+
+        return pos;
+    }
+
+    /* Windows of whole lines bound the space reserved for their values */
+    size_t pos = 0;
+    while (pos < len) {
+        size_t end = pos + STAZ_CLI_READ_CHUNK;
+        if (end < len) {
+            end = (size_t)(staz_text_find(text + end, text + len, '\n', '\n') - text);
+            end += (end < len);
+        } else {
+            end = len;
+        }
+
+        /* Every value line takes at least two bytes, except an unterminated last one */
+        reserve(g, (end - pos) / 2 + 1);
+
+        const int whole = (end < len || last);
+        size_t part = end - pos;
+        size_t n = staz_csv_parse(text + pos, end - pos, c->delim, c->column, g->vals + g->n,
+                                  g->cap - g->n, whole ? NULL : &part);
+        n = keep_finite(g->vals + g->n, n);
+
+        staz_online_update(&g->acc, g->vals + g->n, n);
+        g->n += n;
+        pos += part;
+
+        if (!whole) break;
+    }
+
+    return pos;
+}
+
+/* Splits a mapped text across threads at line boundaries, then merges */
+static void
+feed_text_parallel(const cli* c, group* g, const char* text, size_t len) {
+    const size_t threads = (len >= (1u << 24)) ? max_threads() : 1;
+
+    if (threads <= 1) {
+        feed_text(c, g, text, len, 1);
+        return;
+    }
+
+    group* parts = (group *)xrealloc(NULL, threads * sizeof(group));
+    size_t* cuts = (size_t *)xrealloc(NULL, (threads + 1) * sizeof(size_t));
+
+    cuts[0] = 0;
+    cuts[threads] = len;
+    for (size_t t = 1; t < threads; t++) {
+        const char* p = text + len / threads * t;
+        const char* eol = staz_text_find(p, text + len, '\n', '\n');
+        cuts[t] = (eol < text + len) ? (size_t)(eol + 1 - text) : len;
+        if (cuts[t] < cuts[t - 1]) cuts[t] = cuts[t - 1];
+    }
+
+    STAZ_OMP(omp parallel for schedule(static, 1) num_threads((int)threads))
+    for (long t = 0; t < (long)threads; t++) {
+        parts[t].acc = staz_online_create();
+        parts[t].vals = NULL;
+        parts[t].n = parts[t].cap = 0;
+        feed_text(c, &parts[t], text + cuts[t], cuts[t + 1] - cuts[t], 1);
+    }
+
+    for (size_t t = 0; t < threads; t++) {
+        staz_online_merge(&g->acc, &parts[t].acc);
+
+        if (c->keep) {
+            reserve(g, parts[t].n);
+            memcpy(g->vals + g->n, parts[t].vals, parts[t].n * sizeof(double));
+            g->n += parts[t].n;
+        }
+
+        free(parts[t].vals);
+    }
+
+    free(parts);
+    free(cuts);
+}
+
+static void
+feed_values(const cli* c, group* g, const double* vals, size_t n) {
+    staz_online_update(&g->acc, vals, n);
+
+    if (c->keep) {
+        reserve(g, n);
+        memcpy(g->vals + g->n, vals, n * sizeof(double));
+        g->n += n;
+    }
+}
+
+/* Maps a regular file; returns NULL if it cannot be mapped */
+static const char*
+map_file(const char* path, size_t* len) {
+#if STAZ_HAVE_MMAP
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) die("cannot open", path);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return NULL;
+
+    STAZ_MADVISE(data, (size_t)st.st_size, SEQUENTIAL);
+
+    *len = (size_t)st.st_size;
+    return (const char *)data;
+#else
+    (void)path;
+    (void)len;
+    return NULL;
+#endif
+}
+
+static void
+unmap_file(const char* data, size_t len) {
+#if STAZ_HAVE_MMAP
+    munmap((void *)(uintptr_t)data, len);
+#else
+    (void)data;
+    (void)len;
+#endif
+}
+
+static void
+read_binary(cli* c, group* g, const char* path) {
+    if (strcmp(path, "-") != 0) {
+        staz_column col = staz_column_map(path, c->type);
+
+        if (col.data) {
+            if (!c->keep) {
+                staz_online acc = staz_column_reduce(&col, 0);
+                staz_online_merge(&g->acc, &acc);
+            } else {
+                double* scratch = (double *)xrealloc(NULL, STAZ_COLUMN_CHUNK * sizeof(double));
+
+                for (size_t start = 0; start < col.len; start += STAZ_COLUMN_CHUNK) {
+                    const size_t n = (col.len - start < STAZ_COLUMN_CHUNK) ? col.len - start : STAZ_COLUMN_CHUNK;
+                    feed_values(c, g, staz_column_chunk(&col, start, n, scratch), n);
+                }
+
+                free(scratch);
+            }
+
+            staz_column_unmap(&col);
+            return;
+        }
+    }
+
+    /* Streams (stdin, pipes) and systems without mmap */
+    FILE* f = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    if (!f) die("cannot open", path);
+
+    const size_t width = (c->type == STAZ_COLUMN_F32) ? sizeof(float) : sizeof(double);
+    const size_t cap = STAZ_CLI_READ_CHUNK / width;
+    unsigned char* raw = (unsigned char *)xrealloc(NULL, cap * width);
+    double* vals = (double *)xrealloc(NULL, cap * sizeof(double));
+    const int swap = !little_endian();
+    size_t have = 0;
+
+    for (;;) {
+        const size_t got = fread(raw + have, 1, cap * width - have, f);
+        have += got;
+
+        const size_t n = have / width;
+        for (size_t i = 0; i < n; i++) {
+            unsigned char b[8];
+            memcpy(b, raw + i * width, width);
+
+            if (swap) {
+                for (size_t k = 0; k < width / 2; k++) {
+                    const unsigned char t = b[k];
+                    b[k] = b[width - 1 - k];
+                    b[width - 1 - k] = t;
+                }
+            }
+
+            if (width == sizeof(float)) {
+                float v;
+                memcpy(&v, b, sizeof(v));
+                vals[i] = v;
+            } else {
+                memcpy(&vals[i], b, sizeof(double));
+            }
+        }
+
+        feed_values(c, g, vals, n);
+
+        memmove(raw, raw + n * width, have - n * width);
+        have -= n * width;
+
+        if (got == 0) break;
+    }
+
+    if (ferror(f)) die("read error", path);
+    if (f != stdin) fclose(f);
+
+    free(raw);
+    free(vals);
+}
+
+static void
+read_text(cli* c, const char* path) {
+    const int grouped = (c->key != SIZE_MAX);
+
+    if (strcmp(path, "-") != 0) {
+        size_t len;
+        const char* text = map_file(path, &len);
+
+        if (text) {
+            if (grouped) {
+                feed_grouped(c, text, len, 1);
+            } else {
+                feed_text_parallel(c, &c->groups[0], text, len);
+            }
+
+            unmap_file(text, len);
+            return;
+        }
+    }
+
+    FILE* f = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    if (!f) die("cannot open", path);
+
+    size_t cap = STAZ_CLI_READ_CHUNK, have = 0;
+    char* buf = (char *)xrealloc(NULL, cap);
+
+    for (;;) {
+        /* A single line longer than the buffer makes it grow */
+        if (have == cap) {
+            cap *= 2;
+            buf = (char *)xrealloc(buf, cap);
+        }
+
+        const size_t got = fread(buf + have, 1, cap - have, f);
+        have += got;
+
+        const int last = (got == 0);
+        const size_t used = grouped ? feed_grouped(c, buf, have, last)
+                                    : feed_text(c, &c->groups[0], buf, have, last);
+
+        memmove(buf, buf + used, have - used);
+        have -= used;
+
+        if (last) break;
+    }
+
+    if (ferror(f)) die("read error", path);
+    if (f != stdin) fclose(f);
+
+    free(buf);
+}
+
+/* --- OUTPUT --- */
+
+static void
+compute(const cli* c, group* g, double* out) {
+    size_t posx[128];
+    size_t nq = 0;
+
+    for (size_t i = 0; i < c->nstats; i++) {
+        switch (c->stats[i].kind) {
+            case STAT_MEDIAN: posx[nq++] = 500; break;
+            case STAT_Q1: posx[nq++] = 250; break;
+            case STAT_Q3: posx[nq++] = 750; break;
+            case STAT_IQR: posx[nq++] = 250; posx[nq++] = 750; break;
+            case STAT_PERCENTILE: posx[nq++] = c->stats[i].permille; break;
+            default: break;
+        }
+    }
+
+    /* All order statistics in one selection pass */
+    double q[128];
+    if (nq > 0 && g->n > 0) {
+        staz_quantiles(1000, posx, nq, g->vals, g->n, q);
+    } else {
+        for (size_t i = 0; i < nq; i++) q[i] = NAN;
+    }
+
+    const staz_online* a = &g->acc;
+    const double var = a->n ? a->m2 / a->n : NAN;
+    size_t k = 0;
+
+    for (size_t i = 0; i < c->nstats; i++) {
+        double v = NAN;
+
+        switch (c->stats[i].kind) {
+            case STAT_COUNT: v = (double)a->n; break;
+            case STAT_SUM: v = a->n ? a->mean * a->n : 0.0; break;
+            case STAT_MEAN: v = a->n ? a->mean : NAN; break;
+            case STAT_VAR: v = var; break;
+            case STAT_SD: v = sqrt(var); break;
+            case STAT_MIN: v = a->n ? a->min : NAN; break;
+            case STAT_MAX: v = a->n ? a->max : NAN; break;
+            case STAT_RANGE: v = a->n ? a->max - a->min : NAN; break;
+            case STAT_MEDIAN: case STAT_Q1: case STAT_Q3: case STAT_PERCENTILE: v = q[k++]; break;
+            case STAT_IQR: v = q[k + 1] - q[k]; k += 2; break;
+        }
+
+        out[i] = v;
+    }
+}
+
+static void
+print_number(double v) {
+    if (isnan(v) || isinf(v)) {
+        fputs("null", stdout);
+    } else if (fabs(v) < 1e15 && v == (double)(long long)v) {
+        printf("%lld", (long long)v);
+    } else {
+        printf("%.15g", v);
+    }
+}
+
+static void
+print_json_string(const char* s) {
+    putchar('"');
+    for (; *s; s++) {
+        const unsigned char ch = (unsigned char)*s;
+
+        if (ch == '"' || ch == '\\') {
+            printf("\\%c", ch);
+        } else if (ch < 0x20) {
+            printf("\\u%04x", ch);
+        } else {
+            putchar(ch);
+        }
+    }
+    putchar('"');
+}
+
+static int
+by_key(const void* a, const void* b) {
+    return strcmp(((const group *)a)->key, ((const group *)b)->key);
+}
+
+static void
+print_results(cli* c) {
+    const int grouped = (c->key != SIZE_MAX);
+    double out[64];
+
+    if (grouped) qsort(c->groups, c->ngroups, sizeof(group), by_key);
+
+    if (c->json) {
+        if (grouped) fputs("{", stdout);
+
+        for (size_t g = 0; g < c->ngroups; g++) {
+            compute(c, &c->groups[g], out);
+
+            if (grouped) {
+                fputs(g ? ",\n  " : "\n  ", stdout);
+                print_json_string(c->groups[g].key);
+                fputs(": ", stdout);
+            }
+
+            fputs("{", stdout);
+            for (size_t i = 0; i < c->nstats; i++) {
+                printf("%s\"%s\": ", i ? ", " : "", c->stats[i].name);
+                print_number(out[i]);
+            }
+            fputs("}", stdout);
+        }
+
+        fputs(grouped ? "\n}\n" : "\n", stdout);
+        return;
+    }
+
+    if (grouped) fputs("key\t", stdout);
+    for (size_t i = 0; i < c->nstats; i++) {
+        printf("%s%s", c->stats[i].name, i + 1 < c->nstats ? "\t" : "\n");
+    }
+
+    for (size_t g = 0; g < c->ngroups; g++) {
+        compute(c, &c->groups[g], out);
+
+        if (grouped) printf("%s\t", c->groups[g].key);
+        for (size_t i = 0; i < c->nstats; i++) {
+            if (isnan(out[i])) {
+                fputs("nan", stdout);
+            } else if (isinf(out[i])) {
+                fputs(out[i] > 0 ? "inf" : "-inf", stdout);
+            } else {
+                print_number(out[i]);
+            }
+            putchar(i + 1 < c->nstats ? '\t' : '\n');
+        }
+    }
+}
+
+/* --- MAIN --- */
+
+static void
+usage(void) {
+    fputs("usage: staz [-d delim] [-c col] [-k col] [-b f64|f32] [-s stats] [-f tsv|json] [file ...]\n"
+          "stats: count sum mean var sd min max range median q1 q3 iqr pN\n", stderr);
+    exit(2);
+}
+
+int
+main(int argc, char** argv) {
+    cli c;
+    memset(&c, 0, sizeof(c));
+    c.delim = ',';
+    c.key = SIZE_MAX;
+    parse_stats(&c, "count,mean,sd,min,max");
+
+    int first = argc;
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+
+        if (a[0] != '-' || a[1] == '\0') {
+            first = i;
+            break;
+        }
+        if (strcmp(a, "--") == 0) {
+            first = i + 1;
+            break;
+        }
+        if (a[2] != '\0' || i + 1 == argc) usage();
+
+        const char* v = argv[++i];
+        switch (a[1]) {
+            case 'd':
+                if (strcmp(v, "tab") == 0 || strcmp(v, "\\t") == 0) {
+                    c.delim = '\t';
+                } else if (strlen(v) == 1) {
+                    c.delim = v[0];
+                } else {
+                    die("delimiter must be a single character", v);
+                }
+                break;
+            case 'c': c.column = parse_column(v); break;
+            case 'k': c.key = parse_column(v); break;
+            case 'b':
+                c.binary = 1;
+                if (strcmp(v, "f64") == 0) {
+                    c.type = STAZ_COLUMN_F64;
+                } else if (strcmp(v, "f32") == 0) {
+                    c.type = STAZ_COLUMN_F32;
+                } else {
+                    die("unknown binary type", v);
+                }
+                break;
+            case 's': parse_stats(&c, v); break;
+            case 'f':
+                if (strcmp(v, "json") == 0) {
+                    c.json = 1;
+                } else if (strcmp(v, "tsv") != 0) {
+                    die("unknown format", v);
+                }
+                break;
+            default: usage();
+        }
+    }
+
+    if (c.binary && c.key != SIZE_MAX) die("grouping needs text input", NULL);
+    if (c.delim == '\n') die("invalid delimiter", NULL);
+
+    /* Ungrouped runs accumulate into a single unnamed group */
+    if (c.key == SIZE_MAX) new_group(&c, "", 0);
+
+    if (first == argc) {
+        if (c.binary) read_binary(&c, &c.groups[0], "-"); else read_text(&c, "-");
+    }
+
+    for (int i = first; i < argc; i++) {
+        if (c.binary) read_binary(&c, &c.groups[0], argv[i]); else read_text(&c, argv[i]);
+    }
+
+    print_results(&c);
+
+    for (size_t g = 0; g < c.ngroups; g++) {
+        free(c.groups[g].key);
+        free(c.groups[g].vals);
+    }
+    free(c.groups);
+    free(c.table);
+
+    return 0;
+}